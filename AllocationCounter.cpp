@@ -0,0 +1,108 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef COUNT_ALLOCATIONS
+namespace
+{
+	// every block starts with its size, padded so the caller's pointer keeps malloc's alignment
+	const size_t headerSize = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+	std::atomic<size_t> live{ 0 };
+	std::atomic<size_t> peak{ 0 };
+
+	void* allocate(size_t size) noexcept
+	{
+		unsigned char* block = static_cast<unsigned char*>(std::malloc(size + headerSize));
+		if (!block)
+			return nullptr;
+		std::memcpy(block, &size, sizeof(size));
+
+		const size_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t highest = peak.load(std::memory_order_relaxed);
+		while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed))
+		{
+		}
+		return block + headerSize;
+	}
+
+	void deallocate(void* p) noexcept
+	{
+		if (!p)
+			return;
+		unsigned char* block = static_cast<unsigned char*>(p) - headerSize;
+		size_t size;
+		std::memcpy(&size, block, sizeof(size));
+		live.fetch_sub(size, std::memory_order_relaxed);
+		std::free(block);
+	}
+
+	void* allocateOrThrow(size_t size)
+	{
+		for (;;)
+		{
+			if (void* p = allocate(size ? size : 1))
+				return p;
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+}
+
+bool AllocationCounter::enabled()
+{
+	return true;
+}
+
+size_t AllocationCounter::liveBytes()
+{
+	return live.load(std::memory_order_relaxed);
+}
+
+size_t AllocationCounter::peakBytes()
+{
+	return peak.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::resetPeak()
+{
+	peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// the over-aligned forms are left to the runtime, nothing in the project uses them
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size ? size : 1); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size ? size : 1); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+#else
+bool AllocationCounter::enabled()
+{
+	return false;
+}
+
+size_t AllocationCounter::liveBytes()
+{
+	return 0;
+}
+
+size_t AllocationCounter::peakBytes()
+{
+	return 0;
+}
+
+void AllocationCounter::resetPeak()
+{
+}
+#endif
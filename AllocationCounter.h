@@ -0,0 +1,22 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Bytes live on the heap through the global operator new/delete. AllocationCounter.cpp only
+// replaces them when the program is built with COUNT_ALLOCATIONS defined, as the benchmarks are;
+// otherwise every figure stays 0 and allocations go straight to the runtime. Counting costs an
+// atomic add per allocation. Memory that other modules allocate from their own heap (the ASSIMP
+// dll, the GL driver) is not seen.
+class AllocationCounter
+{
+public:
+	// whether this build counts at all
+	static bool enabled();
+	static size_t liveBytes();
+	// highest liveBytes() since the start or the last resetPeak()
+	static size_t peakBytes();
+	static void resetPeak();
+};
+
+#endif
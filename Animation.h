@@ -2,44 +2,50 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
 #include "Bone.h"
 #include <functional>
 #include "AnimData.h"
-#include "Model.h"
-
-struct AssimpNodeData
-{
-	glm::mat4 transformation;
-	std::string name;
-	int childrenCount;
-	std::vector<AssimpNodeData> children;
-};
+#include "Skeleton.h"
 
 class Animation
 {
 public:
 	Animation() = default;
 
-	Animation(const std::string& animationPath, Model* model)
+	static const unsigned int importFlags = aiProcess_Triangulate;
+
+	// reads one clip of a file that has nothing else to share with the model
+	Animation(const std::string& animationPath, std::shared_ptr<Skeleton> skeleton, unsigned int clip = 0)
 	{
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
-		assert(scene && scene->mRootNode);
-		auto animation = scene->mAnimations[0];
-		m_Duration = animation->mDuration;
-		m_TicksPerSecond = animation->mTicksPerSecond;
-		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-		globalTransformation = globalTransformation.Inverse();
-		ReadHeirarchyData(m_RootNode, scene->mRootNode);
-		ReadMissingBones(animation, *model);
+		const aiScene* scene = importer.ReadFile(animationPath, importFlags);
+		load(scene, clip, std::move(skeleton));
+	}
+
+	// for a scene read beforehand, so the file can be parsed while the model is still loading
+	Animation(const aiScene* scene, std::shared_ptr<Skeleton> skeleton, unsigned int clip = 0)
+	{
+		load(scene, clip, std::move(skeleton));
 	}
 
 	~Animation()
 	{
 	}
 
+	// every clip of the scene, all on the same skeleton
+	static std::vector<std::unique_ptr<Animation>> readClips(const aiScene* scene, const std::shared_ptr<Skeleton>& skeleton)
+	{
+		std::vector<std::unique_ptr<Animation>> clips;
+		for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+			clips.push_back(std::make_unique<Animation>(scene, skeleton, i));
+		return clips;
+	}
+
 	Bone* FindBone(const std::string& name)
 	{
 		auto iter = std::find_if(m_Bones.begin(), m_Bones.end(),
@@ -55,56 +61,44 @@ public:
 
 	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
 	inline float GetDuration() { return m_Duration; }
-	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
+	inline const std::string& GetName() const { return m_Name; }
+	inline const AssimpNodeData& GetRootNode() { return m_Skeleton->rootNode(); }
 	inline const std::map<std::string, BoneInfo>& GetBoneIDMap()
 	{
-		return m_BoneInfoMap;
+		return m_Skeleton->bones();
 	}
+	const Skeleton& GetSkeleton() const { return *m_Skeleton; }
 
 private:
-	void ReadMissingBones(const aiAnimation* animation, Model& model)
+	// the skeleton gains the bones only the animation moves
+	void load(const aiScene* scene, unsigned int clip, std::shared_ptr<Skeleton> skeleton)
 	{
-		int size = animation->mNumChannels;
+		assert(scene && scene->mRootNode && clip < scene->mNumAnimations);
+		m_Skeleton = std::move(skeleton);
+		auto animation = scene->mAnimations[clip];
+		m_Name = animation->mName.C_Str();
+		m_Duration = animation->mDuration;
+		m_TicksPerSecond = animation->mTicksPerSecond;
+		m_Skeleton->readHierarchy(scene->mRootNode);
+		ReadMissingBones(animation);
+	}
 
-		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
-		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+	void ReadMissingBones(const aiAnimation* animation)
+	{
+		int size = animation->mNumChannels;
 
 		//reading channels(bones engaged in an animation and their keyframes)
+		m_Bones.reserve(size);
 		for (int i = 0; i < size; i++)
 		{
 			auto channel = animation->mChannels[i];
-			std::string boneName = channel->mNodeName.data;
-
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				boneInfoMap[boneName].id = boneCount;
-				boneCount++;
-			}
-			m_Bones.push_back(Bone(channel->mNodeName.data,
-				boneInfoMap[channel->mNodeName.data].id, channel));
+			m_Bones.push_back(Bone(channel->mNodeName.data, m_Skeleton->addBone(channel->mNodeName.data), channel));
 		}
-
-		m_BoneInfoMap = boneInfoMap;
 	}
 
-	void ReadHeirarchyData(AssimpNodeData& dest, const aiNode* src)
-	{
-		assert(src);
-
-		dest.name = src->mName.data;
-		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
-		dest.childrenCount = src->mNumChildren;
-
-		for (int i = 0; i < src->mNumChildren; i++)
-		{
-			AssimpNodeData newData;
-			ReadHeirarchyData(newData, src->mChildren[i]);
-			dest.children.push_back(newData);
-		}
-	}
+	std::string m_Name;
 	float m_Duration;
 	int m_TicksPerSecond;
 	std::vector<Bone> m_Bones;
-	AssimpNodeData m_RootNode;
-	std::map<std::string, BoneInfo> m_BoneInfoMap;
+	std::shared_ptr<Skeleton> m_Skeleton;
 };
@@ -0,0 +1,221 @@
+#include "AssetLoader.h"
+#include "ShaderBuildQueue.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+
+AssetLoader::AssetId AssetLoader::add(const std::string& name, Step cpu, Step gl, const std::vector<AssetId>& dependencies)
+{
+	const AssetId id = m_Assets.size();
+	Asset asset;
+	asset.name = name;
+	asset.cpu = std::move(cpu);
+	asset.gl = std::move(gl);
+	asset.dependencies = dependencies;
+	for (AssetId dependency : dependencies)
+	{
+		// assets from an earlier run() are already there, or failed there
+		if (!finished(dependency))
+		{
+			asset.waiting++;
+			m_Assets[dependency].dependents.push_back(id);
+		}
+		else if (failed(dependency) && asset.error.empty())
+			asset.error = "depends on " + m_Assets[dependency].name + ", which failed";
+	}
+	m_Assets.push_back(std::move(asset));
+	return id;
+}
+
+AssetLoader::AssetId AssetLoader::addModel(const std::string& path, std::unique_ptr<Model>& out, bool gamma, GeometryResidency residency)
+{
+	auto data = std::make_shared<ModelData>();
+	return add(path,
+		[path, data] { Model::importModel(path, *data); },
+		[path, data, &out, gamma, residency]
+		{
+			out = std::make_unique<Model>(path, std::move(*data), gamma, residency);
+			*data = ModelData();
+		});
+}
+
+AssetLoader::AssetId AssetLoader::addAnimation(const std::string& path, std::unique_ptr<Model>& model, AssetId modelAsset, std::unique_ptr<Animation>& out)
+{
+	// the importer owns the scene, it lives until the animation has read it
+	auto importer = std::make_shared<Assimp::Importer>();
+	AssetId parse = add(path + " (parse)",
+		[path, importer] { importer->ReadFile(path, Animation::importFlags); },
+		Step());
+
+	// adds the bones only the animation moves to the model's skeleton, which locks for it, so
+	// this can run on the pool too and several clips of one model can bind at once
+	return add(path,
+		[importer, &model, &out]
+		{
+			out = std::make_unique<Animation>(importer->GetScene(), model->skeleton());
+			importer->FreeScene();
+		},
+		Step(), { parse, modelAsset });
+}
+
+AssetLoader::AssetId AssetLoader::addAnimatedModel(const std::string& path, std::unique_ptr<Model>& out, std::vector<std::unique_ptr<Animation>>& clips,
+	bool gamma, GeometryResidency residency)
+{
+	auto data = std::make_shared<ModelData>();
+	return add(path,
+		[path, data, &clips] { Model::importModel(path, *data, &clips); },
+		[path, data, &out, gamma, residency]
+		{
+			out = std::make_unique<Model>(path, std::move(*data), gamma, residency);
+			*data = ModelData();
+		});
+}
+
+AssetLoader::AssetId AssetLoader::addTexture(const std::string& path, unsigned int& out)
+{
+	return add(path, Step(), [path, &out] { out = TextureCache::instance().acquire(path); });
+}
+
+void AssetLoader::schedule(AssetId id)
+{
+	Asset& asset = m_Assets[id];
+	asset.ready = Timer::Clock::now();
+	if (!asset.cpu || !asset.error.empty())
+	{
+		asset.cpuStart = asset.cpuEnd = asset.ready;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CpuFinished.push_back(id);
+		return;
+	}
+
+	ThreadPool::shared().submit([this, id]
+	{
+		Asset& asset = m_Assets[id];
+		asset.cpuStart = Timer::Clock::now();
+		// the future is dropped, an exception left in it would never reach run()
+		try
+		{
+			asset.cpu();
+		}
+		catch (const std::exception& e)
+		{
+			asset.error = e.what();
+		}
+		catch (...)
+		{
+			asset.error = "unknown exception";
+		}
+		asset.cpuEnd = Timer::Clock::now();
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_CpuFinished.push_back(id);
+		}
+		m_CpuDone.notify_one();
+	});
+}
+
+void AssetLoader::run()
+{
+	m_Start = Timer::Clock::now();
+
+	size_t remaining = 0;
+	for (AssetId id = 0; id < m_Assets.size(); id++)
+	{
+		if (finished(id))
+			continue;
+		remaining++;
+		if (m_Assets[id].waiting == 0)
+			schedule(id);
+	}
+
+	while (remaining > 0)
+	{
+		std::vector<AssetId> done;
+		{
+			// wakes up regularly to keep texture uploads going and pick up finished programs while the imports run
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_CpuDone.wait_for(lock, std::chrono::milliseconds(2), [this] { return !m_CpuFinished.empty(); });
+			done.swap(m_CpuFinished);
+		}
+
+		for (AssetId id : done)
+		{
+			Asset& asset = m_Assets[id];
+			asset.glStart = Timer::Clock::now();
+			if (!asset.error.empty())
+				std::cout << "ERROR::ASSET_LOADER:: " << asset.name << ": " << asset.error << std::endl;
+			else if (asset.gl)
+				asset.gl();
+			asset.glEnd = Timer::Clock::now();
+			remaining--;
+
+			for (AssetId dependent : asset.dependents)
+			{
+				// a failed dependency fails the dependent without running its steps
+				if (!asset.error.empty() && m_Assets[dependent].error.empty())
+					m_Assets[dependent].error = "depends on " + asset.name + ", which failed";
+				if (--m_Assets[dependent].waiting == 0)
+					schedule(dependent);
+			}
+		}
+
+		TextureLoader::instance().processUploads();
+		ShaderBuildQueue::instance().poll();
+	}
+
+	m_End = Timer::Clock::now();
+}
+
+// walks back from the asset that finished last, each time to the dependency that released it
+std::vector<AssetLoader::AssetId> AssetLoader::criticalPath() const
+{
+	std::vector<AssetId> path;
+	if (m_Assets.empty())
+		return path;
+
+	AssetId current = 0;
+	for (AssetId id = 1; id < m_Assets.size(); id++)
+	{
+		if (m_Assets[id].glEnd > m_Assets[current].glEnd)
+			current = id;
+	}
+	for (;;)
+	{
+		path.push_back(current);
+		const std::vector<AssetId>& dependencies = m_Assets[current].dependencies;
+		if (dependencies.empty())
+			break;
+		current = *std::max_element(dependencies.begin(), dependencies.end(),
+			[this](AssetId a, AssetId b) { return m_Assets[a].glEnd < m_Assets[b].glEnd; });
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+void AssetLoader::printTimeline() const
+{
+	// ready: dependencies done, wait: queued on the pool, gl wait: CPU step done until the GL thread got to it
+	std::printf("%-24s %9s %9s %9s %9s %9s %9s\n", "asset", "ready ms", "wait", "cpu", "gl wait", "gl", "done ms");
+	double serialMs = 0.0;
+	for (const Asset& asset : m_Assets)
+	{
+		const double cpuMs = Timer::between(asset.cpuStart, asset.cpuEnd);
+		const double glMs = Timer::between(asset.glStart, asset.glEnd);
+		serialMs += cpuMs + glMs;
+		std::printf("%-24s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", asset.name.c_str(),
+			Timer::between(m_Start, asset.ready), Timer::between(asset.ready, asset.cpuStart), cpuMs,
+			Timer::between(asset.cpuEnd, asset.glStart), glMs, Timer::between(m_Start, asset.glEnd));
+	}
+
+	std::string chain;
+	for (AssetId id : criticalPath())
+		chain += (chain.empty() ? "" : " -> ") + m_Assets[id].name;
+	std::printf("critical path: %s\n", chain.c_str());
+	std::printf("loaded in %.1f ms, the steps add up to %.1f ms\n", Timer::between(m_Start, m_End), serialMs);
+}
@@ -0,0 +1,80 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include "Animation.h"
+#include "Model.h"
+#include "Timer.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Loads a manifest of assets concurrently. Every asset has an optional CPU step, run on the
+// shared ThreadPool, and an optional GL step, run on the thread calling run() once its CPU step
+// is done. An asset starts as soon as every asset it depends on has finished both steps, so
+// independent assets overlap and the total is bounded by the slowest dependency chain instead
+// of the sum of all loads. An asset whose CPU step throws fails, and so does everything depending
+// on it. add*() and run() must be called on the thread owning the GL context.
+class AssetLoader
+{
+public:
+	using AssetId = size_t;
+	using Step = std::function<void()>;
+
+	AssetId add(const std::string& name, Step cpu, Step gl, const std::vector<AssetId>& dependencies = {});
+
+	// Model::importModel on the pool, the meshes are created on the GL thread
+	AssetId addModel(const std::string& path, std::unique_ptr<Model>& out, bool gamma = false,
+		GeometryResidency residency = GeometryResidency::GpuOnly);
+
+	// a clip from a file of its own. The file is parsed without waiting for anything, only binding
+	// the bones to the model's skeleton waits for the model
+	AssetId addAnimation(const std::string& path, std::unique_ptr<Model>& model, AssetId modelAsset, std::unique_ptr<Animation>& out);
+
+	// the meshes and every clip of one file from a single parse, the clips use the model's skeleton
+	AssetId addAnimatedModel(const std::string& path, std::unique_ptr<Model>& out, std::vector<std::unique_ptr<Animation>>& clips,
+		bool gamma = false, GeometryResidency residency = GeometryResidency::GpuOnly);
+
+	// through the TextureCache, the TextureLoader decodes and uploads the image in the background
+	AssetId addTexture(const std::string& path, unsigned int& out);
+
+	// loads everything added so far and returns once every asset has finished,
+	// texture uploads are streamed while it waits
+	void run();
+
+	// the CPU step threw or a dependency failed, the GL step was skipped and the outputs are untouched
+	bool failed(AssetId id) const { return !m_Assets[id].error.empty(); }
+
+	// when every asset started and finished relative to run(), and the chain of assets that set the total
+	void printTimeline() const;
+
+private:
+	struct Asset
+	{
+		std::string name;
+		Step cpu;
+		Step gl;
+		std::vector<AssetId> dependencies;
+		std::vector<AssetId> dependents;
+		size_t waiting = 0;  // dependencies that have not finished yet
+		std::string error;   // why the asset failed, empty if it didn't
+		Timer::Clock::time_point ready, cpuStart, cpuEnd, glStart, glEnd;
+	};
+
+	void schedule(AssetId id);
+	bool finished(AssetId id) const { return m_Assets[id].glEnd != Timer::Clock::time_point(); }
+	std::vector<AssetId> criticalPath() const;
+
+	std::vector<Asset> m_Assets;
+	Timer::Clock::time_point m_Start, m_End;
+
+	// assets whose CPU step is done, waiting for their GL step
+	std::mutex m_Mutex;
+	std::condition_variable m_CpuDone;
+	std::vector<AssetId> m_CpuFinished;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "AssetManager.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <unordered_set>
+
+AssetManager::Handle::Handle(Entry* entry) : m_Entry(entry)
+{
+	if (m_Entry)
+		use()->refs++;
+}
+
+AssetManager::Handle::Handle(const Handle& other) : Handle(other.m_Entry)
+{
+}
+
+AssetManager::Handle::Handle(Handle&& other) noexcept : m_Entry(other.m_Entry)
+{
+	other.m_Entry = nullptr;
+}
+
+AssetManager::Handle& AssetManager::Handle::operator=(Handle other) noexcept
+{
+	std::swap(m_Entry, other.m_Entry);
+	return *this;
+}
+
+AssetManager::Handle::~Handle()
+{
+	reset();
+}
+
+void AssetManager::Handle::reset()
+{
+	// the asset stays resident without references until the budget needs its memory
+	if (m_Entry)
+		use()->refs--;
+	m_Entry = nullptr;
+}
+
+bool AssetManager::Handle::ready() const
+{
+	return m_Entry && m_Entry->state == State::Resident;
+}
+
+bool AssetManager::Handle::failed() const
+{
+	return m_Entry && m_Entry->failed;
+}
+
+const std::string& AssetManager::Handle::path() const
+{
+	static const std::string none;
+	return m_Entry ? m_Entry->path : none;
+}
+
+AssetManager::Entry* AssetManager::Handle::use() const
+{
+	m_Entry->lastUsed = AssetManager::instance().m_Frame;
+	return m_Entry;
+}
+
+Model* AssetManager::ModelHandle::get() const
+{
+	return m_Entry ? use()->model.get() : nullptr;
+}
+
+unsigned int AssetManager::TextureHandle::id() const
+{
+	return m_Entry ? use()->texture : 0;
+}
+
+AssetManager& AssetManager::instance()
+{
+	// never destroyed: the models hold GL objects and TextureCache references that can't be
+	// released during static destruction, and pool workers may still be importing into it
+	static AssetManager* manager = new AssetManager();
+	return *manager;
+}
+
+AssetManager::Entry* AssetManager::request(const std::string& path, Kind kind)
+{
+	auto it = m_Entries.find(path);
+	if (it != m_Entries.end())
+		return it->second.get();
+
+	auto entry = std::make_unique<Entry>();
+	entry->kind = kind;
+	entry->path = path;
+	entry->requested = Timer::Clock::now();
+	Entry* raw = entry.get();
+	m_Entries.emplace(path, std::move(entry));
+	m_Loads++;
+
+	if (kind == Kind::Texture)
+	{
+		raw->texture = TextureCache::instance().acquire(path);
+		return raw;
+	}
+
+	// loading entries are never evicted, so the pointer stays valid until update() takes it back
+	raw->imported = std::make_unique<ModelData>();
+	ThreadPool::shared().submit([this, raw]
+	{
+		// the future is dropped, a throwing import has to hand the entry back all the same
+		try
+		{
+			Model::importModel(raw->path, *raw->imported);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "ERROR::ASSET_MANAGER:: " << raw->path << ": " << e.what() << std::endl;
+			raw->failed = true;
+		}
+		catch (...)
+		{
+			std::cout << "ERROR::ASSET_MANAGER:: " << raw->path << ": unknown exception" << std::endl;
+			raw->failed = true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_ImportedEntries.push_back(raw);
+		}
+		m_Imported.notify_all();
+	});
+	return raw;
+}
+
+AssetManager::ModelHandle AssetManager::requestModel(const std::string& path)
+{
+	return ModelHandle(request(path, Kind::Model));
+}
+
+AssetManager::TextureHandle AssetManager::requestTexture(const std::string& path)
+{
+	return TextureHandle(request(path, Kind::Texture));
+}
+
+void AssetManager::update(unsigned int maxModels)
+{
+	m_Frame++;
+
+	std::vector<Entry*> imported;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		size_t count = std::min<size_t>(maxModels, m_ImportedEntries.size());
+		imported.assign(m_ImportedEntries.begin(), m_ImportedEntries.begin() + count);
+		m_ImportedEntries.erase(m_ImportedEntries.begin(), m_ImportedEntries.begin() + count);
+	}
+	for (Entry* entry : imported)
+	{
+		// a failed import is resident without a model, handles see get() return nullptr
+		if (!entry->failed)
+		{
+			entry->model = std::make_unique<Model>(entry->path, std::move(*entry->imported));
+			const Model::GeometryMemory memory = entry->model->geometryMemory();
+			entry->cpuBytes = memory.cpuBytes;
+			entry->gpuBytes = memory.gpuBytes;
+		}
+		entry->imported.reset();
+		entry->state = State::Resident;
+		entry->loadMs = Timer::between(entry->requested, Timer::Clock::now());
+	}
+
+	for (auto& it : m_Entries)
+	{
+		Entry& entry = *it.second;
+		if (entry.kind != Kind::Texture || entry.state != State::Loading)
+			continue;
+		const TextureTiming* timing = TextureLoader::instance().timing(entry.texture);
+		if (!timing || timing->ready || timing->failed)
+		{
+			entry.state = State::Resident;
+			entry.loadMs = Timer::between(entry.requested, Timer::Clock::now());
+		}
+	}
+
+	evict();
+}
+
+void AssetManager::evict()
+{
+	Stats current = stats();
+	m_OverBudget = false;
+	if (current.cpuBytes <= m_Budget.cpuBytes && current.gpuBytes <= m_Budget.gpuBytes)
+		return;
+
+	std::vector<Entry*> cold;
+	for (auto& it : m_Entries)
+	{
+		if (it.second->refs == 0 && it.second->state == State::Resident)
+			cold.push_back(it.second.get());
+	}
+	std::sort(cold.begin(), cold.end(), [](const Entry* a, const Entry* b) { return a->lastUsed < b->lastUsed; });
+
+	for (Entry* entry : cold)
+	{
+		const bool cpuOver = current.cpuBytes > m_Budget.cpuBytes;
+		const bool gpuOver = current.gpuBytes > m_Budget.gpuBytes;
+		if (!cpuOver && !gpuOver)
+			return;
+		// only evict what frees memory of the kind that is over budget
+		const size_t gpuBytes = freedGpuBytes(*entry);
+		if (!(cpuOver && entry->cpuBytes) && !(gpuOver && gpuBytes))
+			continue;
+
+		current.cpuBytes -= entry->cpuBytes;
+		current.gpuBytes -= gpuBytes;
+		if (entry->kind == Kind::Texture)
+			TextureCache::instance().release(entry->texture);
+		m_Entries.erase(entry->path);
+		m_Evictions++;
+	}
+	m_OverBudget = current.cpuBytes > m_Budget.cpuBytes || current.gpuBytes > m_Budget.gpuBytes;
+}
+
+std::unordered_map<unsigned int, unsigned int> AssetManager::textureRefs(const Entry& entry)
+{
+	std::unordered_map<unsigned int, unsigned int> refs;
+	if (entry.kind == Kind::Texture)
+		refs[entry.texture]++;
+	else if (entry.model)
+	{
+		for (const Texture& texture : entry.model->textures_loaded)
+			refs[texture.id]++;
+	}
+	return refs;
+}
+
+size_t AssetManager::textureBytes(unsigned int textureID)
+{
+	const TextureTiming* timing = TextureLoader::instance().timing(textureID);
+	return timing ? timing->gpuBytes : 0;
+}
+
+size_t AssetManager::freedGpuBytes(const Entry& entry)
+{
+	size_t bytes = entry.gpuBytes;
+	for (const auto& it : textureRefs(entry))
+	{
+		if (TextureCache::instance().refCount(it.first) <= it.second)
+			bytes += textureBytes(it.first);
+	}
+	return bytes;
+}
+
+void AssetManager::finish()
+{
+	for (;;)
+	{
+		update(~0u);
+		if (stats().loading == 0)
+			return;
+
+		// textures finish through the loader, models through the pool
+		TextureLoader::instance().processUploads();
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Imported.wait_for(lock, std::chrono::milliseconds(2), [this] { return !m_ImportedEntries.empty(); });
+	}
+}
+
+AssetManager::Stats AssetManager::stats() const
+{
+	Stats stats;
+	// a texture shared by several assets is resident once
+	std::unordered_set<unsigned int> textures;
+	for (const auto& it : m_Entries)
+	{
+		const Entry& entry = *it.second;
+		if (entry.state == State::Loading)
+		{
+			stats.loading++;
+			continue;
+		}
+		stats.resident++;
+		if (entry.refs == 0)
+			stats.cold++;
+		stats.cpuBytes += entry.cpuBytes;
+		stats.gpuBytes += entry.gpuBytes;
+		for (const auto& texture : textureRefs(entry))
+		{
+			if (textures.insert(texture.first).second)
+				stats.gpuBytes += textureBytes(texture.first);
+		}
+	}
+	stats.loads = m_Loads;
+	stats.evictions = m_Evictions;
+	stats.overBudget = m_OverBudget;
+	return stats;
+}
+
+void AssetManager::printStats() const
+{
+	auto megabytes = [](size_t bytes, size_t budget)
+	{
+		char text[64];
+		if (budget == SIZE_MAX)
+			std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+		else
+			std::snprintf(text, sizeof(text), "%.1f/%.1f MB", bytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+		return std::string(text);
+	};
+
+	const Stats current = stats();
+	std::printf("assets: %u resident (%u cold), %u loading, CPU %s, GPU %s, %u loads, %u evictions%s\n",
+		current.resident, current.cold, current.loading, megabytes(current.cpuBytes, m_Budget.cpuBytes).c_str(),
+		megabytes(current.gpuBytes, m_Budget.gpuBytes).c_str(), current.loads, current.evictions,
+		current.overBudget ? ", over budget" : "");
+}
@@ -0,0 +1,157 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include "Model.h"
+#include "Timer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streams models and textures in on demand and unloads them again under a memory budget.
+// request*() returns a ref-counted handle right away. A model is imported on the thread pool
+// and created on the GL thread by update(); a texture goes through the TextureCache and shows
+// its placeholder until the TextureLoader has uploaded it. Assets nobody holds a handle to stay
+// resident while the budget allows, once the resident CPU or GPU bytes exceed it they are
+// evicted least recently used first. The manager and its handles are GL thread only.
+class AssetManager
+{
+	struct Entry;
+
+public:
+	struct Budget
+	{
+		size_t cpuBytes = SIZE_MAX;
+		size_t gpuBytes = SIZE_MAX;
+	};
+
+	struct Stats
+	{
+		unsigned int resident = 0;   // loaded, with or without handles
+		unsigned int cold = 0;       // resident without handles, the candidates for eviction
+		unsigned int loading = 0;
+		size_t cpuBytes = 0;         // model geometry kept in system memory
+		size_t gpuBytes = 0;         // model buffers and texture storage
+		unsigned int loads = 0;
+		unsigned int evictions = 0;
+		bool overBudget = false;     // everything that could be evicted is gone and it still doesn't fit
+	};
+
+	// one reference to an asset, copies add references
+	class Handle
+	{
+	public:
+		Handle() = default;
+		Handle(const Handle& other);
+		Handle(Handle&& other) noexcept;
+		Handle& operator=(Handle other) noexcept;
+		~Handle();
+
+		bool valid() const { return m_Entry != nullptr; }
+		bool ready() const;
+		// the import threw, the asset is ready but holds nothing
+		bool failed() const;
+		const std::string& path() const;
+		void reset();
+
+	protected:
+		explicit Handle(Entry* entry);
+		// marks the asset as used this frame
+		Entry* use() const;
+
+		Entry* m_Entry = nullptr;
+	};
+
+	class ModelHandle : public Handle
+	{
+	public:
+		ModelHandle() = default;
+		// nullptr until the model is resident, and for good if its import failed
+		Model* get() const;
+
+	private:
+		explicit ModelHandle(Entry* entry) : Handle(entry) {}
+		friend class AssetManager;
+	};
+
+	class TextureHandle : public Handle
+	{
+	public:
+		TextureHandle() = default;
+		// the placeholder's name while the image is still loading, the name never changes
+		unsigned int id() const;
+
+	private:
+		explicit TextureHandle(Entry* entry) : Handle(entry) {}
+		friend class AssetManager;
+	};
+
+	static AssetManager& instance();
+
+	ModelHandle requestModel(const std::string& path);
+	TextureHandle requestTexture(const std::string& path);
+
+	void setBudget(const Budget& budget) { m_Budget = budget; }
+	const Budget& budget() const { return m_Budget; }
+
+	// creates up to maxModels imported models, picks up finished textures and evicts down to the
+	// budget, call once per frame
+	void update(unsigned int maxModels = 1);
+
+	// blocks until nothing is loading
+	void finish();
+
+	Stats stats() const;
+	void printStats() const;
+
+private:
+	enum class Kind { Model, Texture };
+	enum class State { Loading, Resident };
+
+	struct Entry
+	{
+		Kind kind;
+		State state = State::Loading;
+		std::string path;
+		unsigned int refs = 0;
+		uint64_t lastUsed = 0;  // frame of the last request or access
+		Timer::Clock::time_point requested;
+		double loadMs = 0.0;
+
+		std::unique_ptr<Model> model;
+		std::unique_ptr<ModelData> imported;  // filled on the pool, turned into model by update()
+		bool failed = false;                  // the import threw, the entry resolves without a model
+		unsigned int texture = 0;
+
+		size_t cpuBytes = 0;
+		size_t gpuBytes = 0;    // model buffers, textures are counted through textureRefs()
+	};
+
+	AssetManager() = default;
+
+	Entry* request(const std::string& path, Kind kind);
+	void evict();
+	// the TextureCache references an entry holds, per texture
+	static std::unordered_map<unsigned int, unsigned int> textureRefs(const Entry& entry);
+	static size_t textureBytes(unsigned int textureID);
+	// what evicting the entry gives back, a shared texture only once its last reference goes
+	static size_t freedGpuBytes(const Entry& entry);
+
+	std::unordered_map<std::string, std::unique_ptr<Entry>> m_Entries;
+	Budget m_Budget;
+	uint64_t m_Frame = 0;
+	unsigned int m_Loads = 0;
+	unsigned int m_Evictions = 0;
+	bool m_OverBudget = false;
+
+	// models whose import finished, waiting for their GL objects
+	std::mutex m_Mutex;
+	std::condition_variable m_Imported;
+	std::vector<Entry*> m_ImportedEntries;
+};
+
+#endif
@@ -0,0 +1,868 @@
+#include "Benchmark.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "AllocationCounter.h"
+#include "AssetManager.h"
+#include "BonePalette.h"
+#include "FrameUniforms.h"
+#include "GLState.h"
+#include "Model.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "ShaderBuildQueue.h"
+#include "ShaderCache.h"
+#include "TextureCooker.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace
+{
+	// the models Game::init loads at startup
+	const char* startupModels[] = { "bird/bird.obj", "untitled.obj", "hearth2.obj" };
+
+	// and the programs it builds
+	const char* startupShaders[] = { "LightingShader", "characterShader", "textShader", "hearthShader", "modelShader" };
+
+	// time until the model and its textures are resident on the GPU
+	double timeModelLoad(const std::string& path)
+	{
+		Timer timer;
+		Model model(path);
+		TextureLoader::instance().finish();
+		glFinish();
+		return timer.elapsedMs();
+	}
+
+	struct TextureLoad
+	{
+		double ms = 0.0;
+		size_t gpuBytes = 0;
+	};
+
+	// time until the texture is resident, the file is read up front so only decode and upload count
+	TextureLoad timeTextureLoad(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		TextureLoader& loader = TextureLoader::instance();
+		Timer timer;
+		unsigned int textureID = loader.load(path, std::move(bytes));
+		loader.finish();
+		glFinish();
+
+		TextureLoad result;
+		result.ms = timer.elapsedMs();
+		result.gpuBytes = loader.timings().back().gpuBytes;
+		GLState::instance().deleteTexture(textureID);
+		return result;
+	}
+
+	// Model's conversion before the geometry arena: arrays grown with push_back and every mesh's
+	// arrays kept in their own vectors, with the capacity left over from welding, until upload.
+	// Bone weights and material textures are left out, which only flatters this path.
+	void legacyProcessScene(const aiScene* scene, std::vector<MeshData>& out)
+	{
+		std::vector<std::vector<MeshData>> parts(scene->mNumMeshes);
+		ThreadPool::shared().parallelFor(scene->mNumMeshes, [&](size_t m)
+		{
+			const aiMesh* mesh = scene->mMeshes[m];
+			MeshData data;
+			for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+			{
+				Vertex vertex = {};
+				for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+					vertex.m_BoneIDs[j] = -1;
+				vertex.Position = AssimpGLMHelpers::GetGLMVec(mesh->mVertices[i]);
+				vertex.Normal = AssimpGLMHelpers::GetGLMVec(mesh->mNormals[i]);
+				if (mesh->mTextureCoords[0])
+					vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+				data.vertices.push_back(vertex);
+			}
+			for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+			{
+				aiFace face = mesh->mFaces[i];
+				for (unsigned int j = 0; j < face.mNumIndices; j++)
+					data.indices.push_back(face.mIndices[j]);
+			}
+
+			MeshOptimizer::optimize(data);
+			parts[m] = MeshOptimizer::splitForShortIndices(data);
+			for (MeshData& part : parts[m])
+			{
+				MeshSimplifier::buildLods(part);
+				part.layout = VertexLayout::choose(part.vertices, false);
+			}
+		});
+
+		for (std::vector<MeshData>& meshParts : parts)
+			for (MeshData& part : meshParts)
+				out.push_back(std::move(part));
+	}
+
+	struct ImportedCounts
+	{
+		size_t meshes = 0;
+		size_t vertices = 0;
+		size_t triangles = 0;
+	};
+
+	ImportedCounts countImported(const ModelData& model)
+	{
+		ImportedCounts counts;
+		counts.meshes = model.meshes.size();
+		for (const MeshGeometry& mesh : model.meshes)
+		{
+			counts.vertices += mesh.vertices.size();
+			counts.triangles += mesh.indices.size() / 3;
+		}
+		return counts;
+	}
+
+	// best of a few runs, the file is in the page cache after the first
+	template<typename F>
+	double bestOf(int runs, F body)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (int run = 0; run < runs; run++)
+		{
+			Timer timer;
+			body();
+			best = std::min(best, timer.elapsedMs());
+		}
+		return best;
+	}
+
+	struct ImportCost
+	{
+		double ms = 0.0;
+		size_t peakBytes = 0;  // highest heap use above the starting point while converting
+		size_t heldBytes = 0;  // heap use above the starting point once converted, what waits for upload
+	};
+
+	// best time of a few runs, the memory figures are the same every run
+	template<typename F>
+	ImportCost measureImport(F convert)
+	{
+		ImportCost cost;
+		cost.ms = std::numeric_limits<double>::max();
+		for (int run = 0; run < 3; run++)
+		{
+			const size_t base = AllocationCounter::liveBytes();
+			AllocationCounter::resetPeak();
+			Timer timer;
+			{
+				auto result = convert();
+				cost.ms = std::min(cost.ms, timer.elapsedMs());
+				cost.heldBytes = AllocationCounter::liveBytes() - base;
+			}
+			cost.peakBytes = AllocationCounter::peakBytes() - base;
+		}
+		return cost;
+	}
+
+	// a program from source strings, for shaders only a benchmark uses
+	GLuint buildProgram(const char* vertexCode, const char* fragmentCode)
+	{
+		GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertex, 1, &vertexCode, NULL);
+		glCompileShader(vertex);
+		GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragment, 1, &fragmentCode, NULL);
+		glCompileShader(fragment);
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+
+		GLint success = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			GLchar infoLog[1024];
+			glGetProgramInfoLog(program, 1024, NULL, infoLog);
+			std::cout << "ERROR::PROGRAM_LINKING_ERROR\n" << infoLog << std::endl;
+		}
+		return program;
+	}
+
+	// a unit cube, 24 vertices so every face has its own normal
+	void cubeGeometry(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (float side : { -1.0f, 1.0f })
+			{
+				glm::vec3 normal(0.0f);
+				normal[axis] = side;
+				const glm::vec3 u(normal.y != 0.0f ? 1.0f : 0.0f, normal.y != 0.0f ? 0.0f : 1.0f, 0.0f);
+				const glm::vec3 v = glm::cross(normal, u);
+				const unsigned int base = static_cast<unsigned int>(vertices.size());
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const float a = (corner & 1) ? 0.5f : -0.5f, b = (corner & 2) ? 0.5f : -0.5f;
+					Vertex vertex = {};
+					vertex.Position = normal * 0.5f + u * a + v * b;
+					vertex.Normal = normal;
+					vertex.TexCoords = glm::vec2(a + 0.5f, b + 0.5f);
+					for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+						vertex.m_BoneIDs[i] = -1;
+					vertices.push_back(vertex);
+				}
+				for (unsigned int index : { 0u, 1u, 3u, 0u, 3u, 2u })
+					indices.push_back(base + index);
+			}
+		}
+	}
+}
+
+int Benchmark::run(const std::string& name)
+{
+	const std::map<std::string, std::function<void()>> benchmarks = {
+		{ "models", modelLoading },
+		{ "textures", textureLoading },
+		{ "layouts", vertexLayouts },
+		{ "meshopt", meshOptimization },
+		{ "lods", levelsOfDetail },
+		{ "memory", geometryMemory },
+		{ "import", importMemory },
+		{ "streaming", assetStreaming },
+		{ "obj", objImport },
+		{ "shaders", shaderCache },
+		{ "shaderqueue", shaderQueue },
+		{ "skinning", skinning },
+		{ "instancing", instancing },
+		{ "multidraw", multiDraw },
+	};
+
+	auto it = benchmarks.find(name);
+	if (it == benchmarks.end())
+	{
+		std::cout << "Unknown benchmark '" << name << "', available:";
+		for (const auto& benchmark : benchmarks)
+			std::cout << " " << benchmark.first;
+		std::cout << std::endl;
+		return 1;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "CS405 Benchmark", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	stbi_set_flip_vertically_on_load(true);
+
+	it->second();
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
+
+void Benchmark::modelLoading()
+{
+	const int warmRuns = 5;
+
+	std::printf("%-16s %12s %12s %12s %10s\n", "model", "cold ms", "warm ms", "cache KB", "speedup");
+	double totalCold = 0.0, totalWarm = 0.0;
+	for (const char* path : startupModels)
+	{
+		std::error_code ec;
+		std::filesystem::remove(MeshCache::cachePathFor(path), ec);
+
+		// cold: nothing cached, the source is parsed and the cache file is written
+		double cold = timeModelLoad(path);
+
+		// warm: best of several runs so the cache file is in the page cache
+		double warm = 0.0;
+		for (int i = 0; i < warmRuns; i++)
+		{
+			double run = timeModelLoad(path);
+			warm = (i == 0) ? run : std::min(warm, run);
+		}
+
+		auto cacheSize = std::filesystem::file_size(MeshCache::cachePathFor(path), ec);
+		std::printf("%-16s %12.2f %12.2f %12.1f %9.1fx\n", path, cold, warm, ec ? 0.0 : cacheSize / 1024.0, cold / warm);
+		totalCold += cold;
+		totalWarm += warm;
+	}
+	std::printf("%-16s %12.2f %12.2f %12s %9.1fx\n", "total", totalCold, totalWarm, "", totalCold / totalWarm);
+}
+
+void Benchmark::textureLoading()
+{
+	const int runs = 5;
+	if (!TextureLoader::compressedSupported())
+	{
+		std::printf("the driver has no GL_EXT_texture_compression_s3tc, cooked textures can't be compared\n");
+		return;
+	}
+
+	std::printf("%-24s %10s %10s %12s %12s %10s %10s\n", "texture", "jpeg ms", "ktx ms", "jpeg KB", "ktx KB", "speedup", "memory");
+	TextureLoad totalSource, totalCooked;
+	for (const std::string& source : TextureCooker::defaultSources())
+	{
+		if (!TextureCooker::isCookedCurrent(source) && !TextureCooker::cook(source))
+			continue;
+
+		TextureLoad best[2];
+		const std::string paths[2] = { source, TextureCooker::cookedPathFor(source) };
+		for (int variant = 0; variant < 2; variant++)
+		{
+			for (int i = 0; i < runs; i++)
+			{
+				TextureLoad run = timeTextureLoad(paths[variant]);
+				if (i == 0 || run.ms < best[variant].ms)
+					best[variant] = run;
+			}
+		}
+
+		std::printf("%-24s %10.2f %10.2f %12.1f %12.1f %9.1fx %9.1fx\n", source.c_str(), best[0].ms, best[1].ms,
+			best[0].gpuBytes / 1024.0, best[1].gpuBytes / 1024.0, best[0].ms / best[1].ms, double(best[0].gpuBytes) / best[1].gpuBytes);
+		totalSource.ms += best[0].ms;
+		totalSource.gpuBytes += best[0].gpuBytes;
+		totalCooked.ms += best[1].ms;
+		totalCooked.gpuBytes += best[1].gpuBytes;
+	}
+	std::printf("%-24s %10.2f %10.2f %12.1f %12.1f %9.1fx %9.1fx\n", "total", totalSource.ms, totalCooked.ms,
+		totalSource.gpuBytes / 1024.0, totalCooked.gpuBytes / 1024.0, totalSource.ms / totalCooked.ms, double(totalSource.gpuBytes) / totalCooked.gpuBytes);
+}
+
+void Benchmark::vertexLayouts()
+{
+	std::printf("%-16s %10s %10s %12s %12s %8s %12s %12s  %s\n", "model", "vertices", "B/vertex", "88 B KB", "layout KB", "saved",
+		"32 bit idx KB", "index KB", "layouts");
+	for (const char* path : startupModels)
+	{
+		Model model(path);
+		TextureLoader::instance().finish();
+
+		size_t vertexCount = 0, fullBytes = 0, layoutBytes = 0, wideIndexBytes = 0, indexBytes = 0;
+		std::set<std::string> layouts;
+		for (const Mesh& mesh : model.meshes)
+		{
+			vertexCount += mesh.vertexCount;
+			fullBytes += mesh.vertexCount * sizeof(Vertex);
+			layoutBytes += mesh.vertexCount * mesh.layout.stride();
+			wideIndexBytes += mesh.indexCount * sizeof(uint32_t);
+			indexBytes += mesh.indexCount * mesh.indexSize();
+			layouts.insert(mesh.layout.describe());
+		}
+
+		std::string names;
+		for (const std::string& layout : layouts)
+			names += (names.empty() ? "" : ", ") + layout;
+
+		// every vertex a draw touches is fetched at the layout's stride, so bandwidth shrinks by the same ratio
+		std::printf("%-16s %10zu %10.1f %12.1f %12.1f %7.0f%% %12.1f %12.1f  %s\n", path, vertexCount,
+			vertexCount ? double(layoutBytes) / vertexCount : 0.0, fullBytes / 1024.0, layoutBytes / 1024.0,
+			fullBytes ? 100.0 * (fullBytes - layoutBytes) / fullBytes : 0.0, wideIndexBytes / 1024.0, indexBytes / 1024.0, names.c_str());
+	}
+}
+
+void Benchmark::meshOptimization()
+{
+	std::printf("%-16s %10s %10s %10s %10s %10s %10s\n", "model", "vertices", "optimized", "ACMR", "optimized", "ATVR", "optimized");
+	for (const char* path : startupModels)
+	{
+		// before: the raw ASSIMP output, one vertex per face corner
+		MeshOptimizer::CacheStats before;
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(path, Model::importFlags);
+			if (!scene || !scene->mRootNode)
+			{
+				std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+				continue;
+			}
+			for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+			{
+				const aiMesh* mesh = scene->mMeshes[m];
+				std::vector<unsigned int> indices;
+				for (unsigned int f = 0; f < mesh->mNumFaces; f++)
+					indices.insert(indices.end(), mesh->mFaces[f].mIndices, mesh->mFaces[f].mIndices + mesh->mFaces[f].mNumIndices);
+				before += MeshOptimizer::analyze(indices, mesh->mNumVertices);
+			}
+		}
+
+		// after: what the model actually uploads
+		MeshOptimizer::CacheStats after;
+		Model model(path, false, GeometryResidency::KeepCpuCopy);
+		TextureLoader::instance().finish();
+		for (const Mesh& mesh : model.meshes)
+		{
+			// full detail level only, the other levels follow it in the same buffer
+			std::vector<unsigned int> indices(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].indexCount);
+			after += MeshOptimizer::analyze(indices, mesh.vertices.size());
+		}
+
+		std::printf("%-16s %10zu %10zu %10.3f %10.3f %10.3f %10.3f\n", path, before.vertices, after.vertices,
+			before.acmr(), after.acmr(), before.atvr(), after.atvr());
+	}
+}
+
+void Benchmark::levelsOfDetail()
+{
+	std::printf("%-16s %4s %10s %8s %12s %14s\n", "model", "lod", "triangles", "ratio", "error", "1px distance");
+	for (const char* path : startupModels)
+	{
+		Model model(path);
+		TextureLoader::instance().finish();
+
+		// radius of the model for scale, and the distance at which each level meets the pixel budget at 1080p
+		const AABB bounds = generateAABB(model);
+		const float pixelsPerUnit = 1080.0f * 0.5f / std::tan(glm::radians(45.0f) * 0.5f);
+
+		size_t fullTriangles = 0;
+		for (const Mesh& mesh : model.meshes)
+			fullTriangles += mesh.lods[0].indexCount / 3;
+
+		for (unsigned int lod = 0; lod < std::max(1u, model.lodCount()); lod++)
+		{
+			size_t triangles = 0;
+			for (const Mesh& mesh : model.meshes)
+				triangles += mesh.lods[std::min<size_t>(lod, mesh.lods.size() - 1)].indexCount / 3;
+
+			const float error = model.lodError(lod);
+			std::printf("%-16s %4u %10zu %7.1f%% %11.2f%% %14.1f\n", lod == 0 ? path : "", lod, triangles,
+				100.0 * triangles / std::max<size_t>(fullTriangles, 1), 100.0f * error / std::max(glm::length(bounds.extents), 1e-6f),
+				error * pixelsPerUnit / Entity::lodPixelError);
+		}
+	}
+}
+
+void Benchmark::geometryMemory()
+{
+	std::printf("%-16s %12s %14s %12s %16s\n", "model", "GPU KB", "CPU KB kept", "CPU KB freed", "CPU KB collision");
+	for (const char* path : startupModels)
+	{
+		const GeometryResidency policies[] = { GeometryResidency::KeepCpuCopy, GeometryResidency::GpuOnly, GeometryResidency::GpuWithCollision };
+		Model::GeometryMemory memory[3];
+		for (int i = 0; i < 3; i++)
+		{
+			Model model(path, false, policies[i]);
+			TextureLoader::instance().finish();
+			memory[i] = model.geometryMemory();
+		}
+		std::printf("%-16s %12.1f %14.1f %12.1f %16.1f\n", path, memory[0].gpuBytes / 1024.0,
+			memory[0].cpuBytes / 1024.0, memory[1].cpuBytes / 1024.0, memory[2].cpuBytes / 1024.0);
+	}
+}
+
+void Benchmark::importMemory()
+{
+	// start the workers before measuring, their stacks and queues are not import memory
+	ThreadPool::shared();
+
+	if (!AllocationCounter::enabled())
+		std::printf("built without COUNT_ALLOCATIONS, the memory columns read 0\n");
+	std::printf("%-16s %10s %10s %12s %12s %12s %12s\n", "model", "ms before", "ms arena", "peak KB", "peak arena", "held KB", "held arena");
+	for (const char* path : startupModels)
+	{
+		// the scene is read once, both paths convert the same aiScene
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, Model::importFlags);
+		if (!scene || !scene->mRootNode)
+		{
+			std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+			continue;
+		}
+
+		const ImportCost before = measureImport([&]
+		{
+			std::vector<MeshData> meshes;
+			legacyProcessScene(scene, meshes);
+			return meshes;
+		});
+		const ImportCost arena = measureImport([&]
+		{
+			auto model = std::make_unique<ModelData>();
+			Model::processScene(scene, *model);
+			return model;
+		});
+
+		std::printf("%-16s %10.2f %10.2f %12.1f %12.1f %12.1f %12.1f\n", path, before.ms, arena.ms,
+			before.peakBytes / 1024.0, arena.peakBytes / 1024.0, before.heldBytes / 1024.0, arena.heldBytes / 1024.0);
+	}
+}
+
+void Benchmark::assetStreaming()
+{
+	AssetManager& assets = AssetManager::instance();
+
+	// first pass without a budget to learn what every model takes
+	size_t totalGpuBytes = 0;
+	for (const char* path : startupModels)
+	{
+		AssetManager::ModelHandle model = assets.requestModel(path);
+		assets.finish();
+		totalGpuBytes += model.get()->geometryMemory().gpuBytes;
+	}
+	assets.printStats();
+
+	AssetManager::Budget budget;
+	budget.gpuBytes = totalGpuBytes / 2;
+	assets.setBudget(budget);
+	assets.update();
+	assets.printStats();
+
+	std::vector<const char*> order(std::begin(startupModels), std::end(startupModels));
+	order.push_back(startupModels[0]);
+	for (const char* path : order)
+	{
+		Timer timer;
+		AssetManager::ModelHandle model = assets.requestModel(path);
+		assets.finish();
+		std::printf("%-16s %8.2f ms  ", path, timer.elapsedMs());
+		assets.printStats();
+	}
+	assets.setBudget(AssetManager::Budget());
+}
+
+void Benchmark::objImport()
+{
+	const int runs = 5;
+	ThreadPool::shared();
+
+	std::printf("%-16s %10s %10s %10s %10s %8s %20s %20s\n", "model", "parse", "parse obj", "import", "import obj",
+		"speedup", "assimp mesh/vtx/tri", "obj mesh/vtx/tri");
+	for (const char* path : startupModels)
+	{
+		// parse only: the file to an aiScene vs to ObjLoader's arrays
+		const double assimpParse = bestOf(runs, [&]
+		{
+			Assimp::Importer importer;
+			importer.ReadFile(path, Model::importFlags);
+		});
+		const double objParse = bestOf(runs, [&]
+		{
+			ObjLoader obj;
+			obj.open(path);
+		});
+
+		// the whole import Model does on a cache miss, up to the cooked meshes in the arena
+		ModelData assimpModel, objModel;
+		const double assimpImport = bestOf(runs, [&]
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(path, Model::importFlags);
+			assimpModel = ModelData();
+			if (scene && scene->mRootNode)
+				Model::processScene(scene, assimpModel);
+		});
+		const double objImport = bestOf(runs, [&]
+		{
+			ObjLoader obj;
+			objModel = ModelData();
+			if (obj.open(path))
+				Model::processObj(obj, objModel);
+		});
+
+		const ImportedCounts assimpCounts = countImported(assimpModel);
+		const ImportedCounts objCounts = countImported(objModel);
+		char assimpText[32], objText[32];
+		std::snprintf(assimpText, sizeof(assimpText), "%zu/%zu/%zu", assimpCounts.meshes, assimpCounts.vertices, assimpCounts.triangles);
+		std::snprintf(objText, sizeof(objText), "%zu/%zu/%zu", objCounts.meshes, objCounts.vertices, objCounts.triangles);
+		std::printf("%-16s %10.2f %10.2f %10.2f %10.2f %7.1fx %20s %20s\n", path, assimpParse, objParse,
+			assimpImport, objImport, assimpImport / objImport, assimpText, objText);
+	}
+}
+
+void Benchmark::shaderCache()
+{
+	// cold: every program misses and is compiled, linked and stored. warm: every program is a hit
+	for (const char* pass : { "cold", "warm" })
+	{
+		if (pass[0] == 'c')
+		{
+			std::error_code ec;
+			std::filesystem::remove_all("shadercache", ec);
+		}
+		ShaderCache::resetStats();
+		Timer timer;
+		for (const char* name : startupShaders)
+		{
+			Shader shader((std::string(name) + ".vert").c_str(), (std::string(name) + ".frag").c_str());
+			glDeleteProgram(shader.ID);
+		}
+		glFinish();
+		std::printf("%s: %.1f ms for %zu programs, ", pass, timer.elapsedMs(), std::size(startupShaders));
+		ShaderCache::printStats();
+	}
+	std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Benchmark::shaderQueue()
+{
+	ShaderBuildQueue& queue = ShaderBuildQueue::instance();
+	const char* model = startupModels[1];
+	std::printf("parallel shader compile: %s\n", queue.parallel() ? "yes" : "no");
+
+	auto importModel = [&]
+	{
+		std::error_code ec;
+		std::filesystem::remove(MeshCache::cachePathFor(model), ec);
+		ModelData data;
+		Model::importModel(model, data);
+	};
+
+	for (const char* pass : { "serial", "queued" })
+	{
+		std::error_code ec;
+		std::filesystem::remove_all("shadercache", ec);
+		std::vector<GLuint> programs;
+
+		Timer timer;
+		double blockedMs = 0.0;
+		if (pass[0] == 's')
+		{
+			for (const char* name : startupShaders)
+				programs.push_back(Shader((std::string(name) + ".vert").c_str(), (std::string(name) + ".frag").c_str()).ID);
+			blockedMs = timer.elapsedMs();
+			importModel();
+		}
+		else
+		{
+			for (const char* name : startupShaders)
+				programs.push_back(queue.submit((std::string(name) + ".vert").c_str(), (std::string(name) + ".frag").c_str()));
+			blockedMs = timer.elapsedMs();
+			importModel();
+			Timer finish;
+			queue.finishAll();
+			blockedMs += finish.elapsedMs();
+		}
+		const double totalMs = timer.elapsedMs();
+
+		for (GLuint program : programs)
+			glDeleteProgram(program);
+		std::printf("%-8s %8.1f ms total, %8.1f ms waiting on shaders, %s imported\n", pass, totalMs, blockedMs, model);
+	}
+}
+
+void Benchmark::skinning()
+{
+	// every vertex reads one bone, so the palette is all the draw needs
+	const char* uniformVertex =
+		"#version 330 core\n"
+		"uniform mat4 finalBonesMatrices[100];\n"
+		"void main() { gl_Position = finalBonesMatrices[gl_VertexID] * vec4(0.0, 0.0, 0.0, 1.0); }\n";
+	const char* blockVertex =
+		"#version 330 core\n"
+		"layout (std140) uniform Bones { mat4 finalBonesMatrices[100]; };\n"
+		"void main() { gl_Position = finalBonesMatrices[gl_VertexID] * vec4(0.0, 0.0, 0.0, 1.0); }\n";
+	const char* fragment =
+		"#version 330 core\n"
+		"out vec4 FragColor;\n"
+		"void main() { FragColor = vec4(1.0); }\n";
+
+	const int characters = 1000;
+	const int frames = 100;
+	std::vector<glm::mat4> bones(BonePalette::maxBones, glm::mat4(1.0f));
+
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	GLState::instance().bindVertexArray(vao);
+
+	for (const char* pass : { "uniforms", "palette" })
+	{
+		const bool palette = pass[0] == 'p';
+		Shader shader(buildProgram(palette ? blockVertex : uniformVertex, fragment));
+		BonePalette bonePalette;
+		if (palette)
+		{
+			BonePalette::bindBlock(shader.ID);
+			bonePalette.setup();
+		}
+		shader.use();
+
+		Timer timer;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			if (palette)
+			{
+				// every pose of the frame in one upload, then a range bind per draw
+				bonePalette.beginFrame();
+				for (int character = 0; character < characters; character++)
+				{
+					bones[0][3][0] = static_cast<float>(character);
+					bonePalette.write(bones.data(), BonePalette::maxBones);
+				}
+				bonePalette.upload();
+				for (int character = 0; character < characters; character++)
+				{
+					bonePalette.bind(character);
+					glDrawArrays(GL_POINTS, 0, BonePalette::maxBones);
+				}
+				continue;
+			}
+			for (int character = 0; character < characters; character++)
+			{
+				// a different pose for every character
+				bones[0][3][0] = static_cast<float>(character);
+				shader.setMat4Array("finalBonesMatrices", bones.data(), BonePalette::maxBones);
+				glDrawArrays(GL_POINTS, 0, BonePalette::maxBones);
+			}
+		}
+		glFinish();
+		std::printf("%-8s %8.2f ms per frame, %d characters of %d bones\n", pass, timer.elapsedMs() / frames, characters, BonePalette::maxBones);
+
+		if (palette)
+			bonePalette.Delete();
+		glDeleteProgram(shader.ID);
+	}
+
+	GLState::instance().deleteVertexArray(vao);
+	std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Benchmark::instancing()
+{
+	const int side = 100;  // a side x side grid of cubes
+	const int frames = 50;
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	cubeGeometry(vertices, indices);
+	Mesh cube(vertices, indices, 0, VertexLayout::choose(vertices, false));
+	GLuint texture;
+	glGenTextures(1, &texture);
+	// no textures of its own, so the queue binds texture in their place
+	Material material(MaterialSource(), {});
+
+	Camera camera(glm::vec3(0.0f, 0.0f, 150.0f));
+	FrameUniforms frameUniforms;
+	frameUniforms.setup();
+	RenderQueue queue;
+	queue.setup();
+
+	std::vector<glm::mat4> transforms;
+	for (int x = 0; x < side; x++)
+	{
+		for (int y = 0; y < side; y++)
+			transforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(x - side / 2, y - side / 2, 0.0f)));
+	}
+
+	for (const char* pass : { "uniforms", "instanced" })
+	{
+		const bool instanced = pass[0] == 'i';
+		Shader shader(instanced ? "modelShaderInstanced.vert" : "modelShader.vert", "modelShader.frag");
+
+		// one frame first, so the program is linked and the buffers have their size
+		double bestMs = std::numeric_limits<double>::max();
+		for (int frame = 0; frame <= frames; frame++)
+		{
+			Timer timer;
+			frameUniforms.update(camera, camera, 1.0f);
+			queue.clear();
+			for (const glm::mat4& transform : transforms)
+				queue.add(shader, FrameUniforms::CameraFar, cube, material, 0, texture, transform, glm::length(glm::vec3(transform[3]) - camera.Position));
+			queue.submit(frameUniforms);
+			glFinish();
+			if (frame > 0)
+				bestMs = std::min(bestMs, timer.elapsedMs());
+		}
+		const RenderQueue::Stats& stats = queue.stats();
+		std::printf("%-9s %8.2f ms per frame, %zu cubes in %zu draw calls\n", pass, bestMs, stats.draws, stats.drawCalls);
+		glDeleteProgram(shader.ID);
+	}
+
+	material.release();
+	queue.Delete();
+	frameUniforms.Delete();
+	GLState::instance().deleteTexture(texture);
+	std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void Benchmark::multiDraw()
+{
+	const int segments = 100;  // copies of the corridor, one after the other
+	const int frames = 50;
+
+	Model corridor("untitled.obj");
+	TextureLoader::instance().finish();
+	GLuint texture;
+	glGenTextures(1, &texture);
+	std::printf("%s: %zu meshes\n", "untitled.obj", corridor.meshes.size());
+	GeometryPool::instance().printStats();
+
+	Camera camera(glm::vec3(0.0f, 0.0f, 10.0f));
+	FrameUniforms frameUniforms;
+	frameUniforms.setup();
+	RenderQueue queue;
+	queue.setup();
+
+	for (const char* pass : { "uniforms", "loop", "multidraw" })
+	{
+		const bool instanced = pass[0] != 'u';
+		queue.setMultiDraw(pass[0] == 'm');
+		if (pass[0] == 'm' && !queue.multiDraw())
+		{
+			std::printf("%-9s needs GL 4.3\n", pass);
+			continue;
+		}
+		Shader shader(instanced ? "LightingShaderInstanced.vert" : "LightingShader.vert", "LightingShader.frag");
+
+		// one frame first, so the program is linked and the buffers have their size
+		double bestMs = std::numeric_limits<double>::max();
+		for (int frame = 0; frame <= frames; frame++)
+		{
+			Timer timer;
+			frameUniforms.update(camera, camera, 1.0f);
+			queue.clear();
+			for (int segment = 0; segment < segments; segment++)
+			{
+				const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -20.0f, -10.0f * segment)), glm::vec3(0.075f));
+				for (const Mesh& mesh : corridor.meshes)
+					queue.add(shader, FrameUniforms::CameraFar, mesh, corridor.materials[mesh.material], 0, texture, transform, 10.0f * segment);
+			}
+			queue.submit(frameUniforms);
+			glFinish();
+			if (frame > 0)
+				bestMs = std::min(bestMs, timer.elapsedMs());
+		}
+		const RenderQueue::Stats& stats = queue.stats();
+		std::printf("%-9s %8.2f ms per frame, %zu mesh draws in %zu draw calls, %zu VAO binds\n", pass, bestMs, stats.draws, stats.drawCalls, stats.vaosBound);
+		glDeleteProgram(shader.ID);
+	}
+
+	queue.Delete();
+	frameUniforms.Delete();
+	GLState::instance().deleteTexture(texture);
+	std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
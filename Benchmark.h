@@ -0,0 +1,65 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+// Offline measurements, started with "CS405_Project.exe --bench <name>" instead of the game.
+// Each benchmark gets a hidden window for its GL context and prints its report to stdout.
+class Benchmark
+{
+public:
+	// runs the named benchmark, returns the process exit code
+	static int run(const std::string& name);
+
+	// cold (source import + cache write) vs warm (mesh cache) load of the models Game::init loads
+	static void modelLoading();
+
+	// source JPEG (decode + glGenerateMipmap) vs cooked KTX (compressed mips) load time and GPU memory
+	static void textureLoading();
+
+	// vertex buffer size and bytes fetched per vertex of the per mesh layouts vs the 88 byte Vertex,
+	// and index buffer size at the chosen index width vs always 32 bit
+	static void vertexLayouts();
+
+	// vertex count, ACMR and ATVR of what ASSIMP returns vs what MeshOptimizer uploads
+	static void meshOptimization();
+
+	// triangles and simplification error of every level of detail
+	static void levelsOfDetail();
+
+	// CPU and GPU geometry bytes per model under each GeometryResidency
+	static void geometryMemory();
+
+	// time and peak heap use of converting an ASSIMP scene the way Model did before the geometry
+	// arena (growing vectors, every mesh's arrays held separately) vs Model::processScene
+	static void importMemory();
+
+	// parse and full import time of the startup models through ObjLoader vs ASSIMP, with the mesh,
+	// vertex and triangle counts both produce
+	static void objImport();
+
+	// the programs Game::init builds, compiled from source vs loaded from the program binary cache
+	static void shaderCache();
+
+	// the startup programs compiled one after the other and then a model imported, vs submitted to
+	// the ShaderBuildQueue up front with the import running while the driver compiles. Cache bypassed.
+	static void shaderQueue();
+
+	// the bones of many animated characters per frame, set as a uniform array on the program for
+	// every character vs uploaded into BonePalette slots
+	static void skinning();
+
+	// 10000 cubes of one mesh through the RenderQueue, a draw and a model uniform per cube vs
+	// instanced draws of the batched model matrices
+	static void instancing();
+
+	// 100 corridors from the GeometryPool through the RenderQueue: a draw per mesh with a model
+	// uniform, instanced with a draw per mesh, and instanced with a multi draw per pool
+	static void multiDraw();
+
+	// the startup models streamed through the AssetManager under a GPU budget of half their total,
+	// one held at a time, then the first one requested again
+	static void assetStreaming();
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "BonePalette.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void BonePalette::setup(int slots)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	const GLsizeiptr bytes = maxBones * static_cast<GLsizeiptr>(sizeof(glm::mat4));
+	m_Stride = (bytes + alignment - 1) / alignment * alignment;
+	m_Slots = std::max(slots, 1);
+	m_Next = 0;
+	m_Staging.assign(static_cast<size_t>(m_Stride * m_Slots), 0);
+
+	glGenBuffers(1, &m_Buffer);
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Slots, nullptr, GL_STREAM_DRAW);
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void BonePalette::Delete()
+{
+	GLState::instance().deleteBuffer(m_Buffer);
+	m_Buffer = 0;
+	m_Staging.clear();
+	m_Staging.shrink_to_fit();
+}
+
+int BonePalette::write(const glm::mat4* bones, int count)
+{
+	if (count > maxBones)
+	{
+		std::cout << "ERROR::BONE_PALETTE:: " << count << " bones, only the first " << maxBones << " are uploaded" << std::endl;
+		count = maxBones;
+	}
+
+	const int slot = m_Next++;
+	const size_t offset = static_cast<size_t>(slot * m_Stride);
+	if (m_Staging.size() < offset + static_cast<size_t>(m_Stride))
+		m_Staging.resize(offset + static_cast<size_t>(m_Stride), 0);
+	if (count > 0)
+		std::memcpy(m_Staging.data() + offset, bones, count * sizeof(glm::mat4));
+	return slot;
+}
+
+void BonePalette::upload()
+{
+	if (m_Next == 0)
+		return;
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	const GLsizeiptr bytes = m_Stride * m_Next;
+	if (m_Next > m_Slots)
+	{
+		m_Slots = m_Next;
+		glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Slots, m_Staging.data(), GL_STREAM_DRAW);
+		return;
+	}
+
+	// invalidated, not overwritten, so the upload doesn't wait for the previous frame's draws
+	if (void* slots = glMapBufferRange(GL_UNIFORM_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))
+	{
+		std::memcpy(slots, m_Staging.data(), static_cast<size_t>(bytes));
+		if (glUnmapBuffer(GL_UNIFORM_BUFFER))
+			return;
+	}
+	// could not map, or the store was lost while mapped
+	glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Slots, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, m_Staging.data());
+}
+
+void BonePalette::bind(int slot)
+{
+	// the whole slot, the block is declared with maxBones matrices
+	GLState::instance().bindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer, slot * m_Stride, maxBones * static_cast<GLsizeiptr>(sizeof(glm::mat4)));
+}
+
+void BonePalette::bindBlock(GLuint program)
+{
+	const GLuint index = glGetUniformBlockIndex(program, blockName);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, binding);
+}
@@ -0,0 +1,57 @@
+#ifndef BONE_PALETTE_H
+#define BONE_PALETTE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Final bone matrices of the skinned instances drawn in a frame, streamed through one uniform
+// buffer. Every instance writes its palette into its own slot of a staging copy, the frame's
+// slots go to the buffer in one upload and each draw picks its slot with glBindBufferRange, so
+// any number of animated characters cost one transfer a frame and no uniform per bone. Skinned
+// shaders declare
+//
+//     layout (std140) uniform Bones
+//     {
+//         mat4 finalBonesMatrices[100];
+//     };
+//
+// The buffer is orphaned by every upload, last frame's draws keep reading the old storage. A frame
+// with more instances than slots grows the buffer.
+class BonePalette
+{
+public:
+	static constexpr GLuint binding = 1;
+	static constexpr const char* blockName = "Bones";
+	static constexpr int maxBones = 100;
+
+	// creates the buffer, needs a context. 256 slots of 100 bones are 1.6 MB
+	void setup(int slots = 256);
+	void Delete();
+
+	// starts a new frame's palettes
+	void beginFrame() { m_Next = 0; }
+
+	// copies count matrices into the next slot of the frame and returns it, the rest of the slot
+	// is left as is
+	int write(const glm::mat4* bones, int count);
+
+	// sends the slots written this frame to the buffer, after the writes and before the draws
+	void upload();
+
+	// binds a slot of the last upload
+	void bind(int slot);
+
+	// points the program's Bones block, if it has one, at the binding point
+	static void bindBlock(GLuint program);
+
+private:
+	GLuint m_Buffer = 0;
+	GLsizeiptr m_Stride = 0;  // maxBones matrices rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	int m_Slots = 0;          // the buffer holds this many
+	int m_Next = 0;           // slots written this frame
+	std::vector<unsigned char> m_Staging;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "FrameUniforms.h"
+#include "GLState.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+
+void FrameUniforms::setup()
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_Stride = (static_cast<GLsizeiptr>(sizeof(Block)) + alignment - 1) / alignment * alignment;
+	m_Staging.assign(static_cast<size_t>(m_Stride) * ViewCount, 0);
+
+	glGenBuffers(1, &m_Buffer);
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_Staging.size()), nullptr, GL_STREAM_DRAW);
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_Bound = -1;
+}
+
+void FrameUniforms::Delete()
+{
+	GLState::instance().deleteBuffer(m_Buffer);
+	m_Buffer = 0;
+	m_Bound = -1;
+}
+
+FrameUniforms::Block FrameUniforms::makeBlock(Camera& camera, const glm::vec3& lightPosition, float aspect, float zNear, float zFar) const
+{
+	Block block;
+	block.projection = glm::perspective(glm::radians(camera.Zoom), aspect, zNear, zFar);
+	block.view = camera.GetViewMatrix();
+	block.viewPos = glm::vec4(camera.Position, 1.0f);
+	block.lightPosition = glm::vec4(lightPosition, 1.0f);
+	block.lightAmbient = glm::vec4(light.ambient, 0.0f);
+	block.lightDiffuse = glm::vec4(light.diffuse, 0.0f);
+	block.lightSpecular = glm::vec4(light.specular, 0.0f);
+	block.lightAttenuation = glm::vec4(light.constant, light.linear, light.quadratic, 0.0f);
+	return block;
+}
+
+void FrameUniforms::update(Camera& camera, Camera& spy, float aspect)
+{
+	const glm::vec3 lightPosition = camera.Position + light.offset;
+	const Block blocks[ViewCount] = {
+		makeBlock(camera, lightPosition, aspect, 0.1f, 100.0f),
+		makeBlock(camera, lightPosition, aspect, 1.0f, 1000.0f),
+		makeBlock(spy, lightPosition, aspect, 0.1f, 100.0f),
+		makeBlock(spy, lightPosition, aspect, 1.0f, 1000.0f),
+	};
+	for (int i = 0; i < ViewCount; i++)
+		std::memcpy(m_Staging.data() + i * m_Stride, &blocks[i], sizeof(Block));
+
+	// orphan last frame's storage so the driver doesn't wait for draws still reading it
+	GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_Staging.size()), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(m_Staging.size()), m_Staging.data());
+	// the range binding still points at the buffer name, it sees the new storage
+}
+
+void FrameUniforms::bind(View view)
+{
+	if (m_Bound == view)
+		return;
+	GLState::instance().bindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer, view * m_Stride, sizeof(Block));
+	m_Bound = view;
+}
+
+void FrameUniforms::bindBlock(GLuint program)
+{
+	const GLuint index = glGetUniformBlockIndex(program, blockName);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, binding);
+}
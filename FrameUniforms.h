@@ -0,0 +1,91 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+#include <vector>
+
+// The camera and light of a frame in one std140 uniform buffer, read by every program that
+// declares the Frame block below. Each view the renderer draws with gets its own copy of the
+// block, all of them are written in one upload per frame and a view is picked with
+// glBindBufferRange, so switching programs or views sets no per-draw camera or light uniforms.
+//
+//     layout (std140) uniform Frame
+//     {
+//         mat4 projection;
+//         mat4 view;
+//         vec4 viewPos;
+//         vec4 lightPosition;
+//         vec4 lightAmbient;
+//         vec4 lightDiffuse;
+//         vec4 lightSpecular;
+//         vec4 lightAttenuation;  // constant, linear, quadratic
+//     };
+//
+// GLSL 3.30 has no binding qualifier, programs are pointed at the binding point when they link.
+class FrameUniforms
+{
+public:
+	static constexpr GLuint binding = 0;
+	static constexpr const char* blockName = "Frame";
+
+	enum View
+	{
+		CameraNear,  // main camera, 0.1 - 100
+		CameraFar,   // main camera, 1 - 1000
+		SpyNear,     // spy camera, 0.1 - 100
+		SpyFar,      // spy camera, 1 - 1000
+		ViewCount
+	};
+
+	struct Light
+	{
+		glm::vec3 offset = glm::vec3(0.0f, -1.0f, -4.0f);  // from the main camera, it follows the bird
+		glm::vec3 ambient = glm::vec3(1.0f);
+		glm::vec3 diffuse = glm::vec3(1.0f);
+		glm::vec3 specular = glm::vec3(1.0f);
+		float constant = 1.0f;
+		float linear = 0.0f;
+		float quadratic = 0.0f;
+	};
+	Light light;
+
+	// creates the buffer, needs a context
+	void setup();
+	void Delete();
+
+	// writes every view once, call before the first draw of the frame
+	void update(Camera& camera, Camera& spy, float aspect);
+	// binds one view's block to the binding point, does nothing if it is bound already
+	void bind(View view);
+
+	// points the program's Frame block, if it has one, at the binding point
+	static void bindBlock(GLuint program);
+
+private:
+	// std140 layout of the block, every member is 16 byte aligned
+	struct Block
+	{
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec4 viewPos;
+		glm::vec4 lightPosition;
+		glm::vec4 lightAmbient;
+		glm::vec4 lightDiffuse;
+		glm::vec4 lightSpecular;
+		glm::vec4 lightAttenuation;
+	};
+	static_assert(sizeof(Block) == 224, "Frame block must match its std140 layout");
+
+	Block makeBlock(Camera& camera, const glm::vec3& lightPosition, float aspect, float zNear, float zFar) const;
+
+	GLuint m_Buffer = 0;
+	GLsizeiptr m_Stride = 0;  // sizeof(Block) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	std::vector<unsigned char> m_Staging;
+	int m_Bound = -1;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "GLState.h"
+
+#include <cstdio>
+
+namespace
+{
+	const GLenum trackedCapabilities[] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+
+	const char* callNames[GLState::CallCount] = {
+		"program", "vertex array", "active texture", "texture", "buffer", "buffer range",
+		"enable/disable", "blend func", "depth", "viewport", "bone defaults"
+	};
+}
+
+size_t GLState::Counters::totalIssued() const
+{
+	size_t total = 0;
+	for (size_t count : issued)
+		total += count;
+	return total;
+}
+
+size_t GLState::Counters::totalSuppressed() const
+{
+	size_t total = 0;
+	for (size_t count : suppressed)
+		total += count;
+	return total;
+}
+
+GLState& GLState::instance()
+{
+	static GLState state;
+	return state;
+}
+
+GLState::GLState()
+{
+	invalidate();
+}
+
+void GLState::invalidate()
+{
+	m_Program = unknown;
+	m_VertexArray = unknown;
+	m_ActiveUnit = unknown;
+	forgetTextures();
+	for (GLuint& buffer : m_Buffers)
+		buffer = unknown;
+	for (IndexedBinding& binding : m_UniformBindings)
+		binding = { unknown, -1, -1 };
+	for (int& capability : m_Capabilities)
+		capability = -1;
+	m_BlendSource = m_BlendDestination = unknown;
+	m_DepthFunc = unknown;
+	m_DepthMask = 0xFF;
+	m_Viewport[0] = m_Viewport[1] = m_Viewport[2] = m_Viewport[3] = -1;
+	m_BoneDefaults = false;
+}
+
+void GLState::forgetTextures()
+{
+	for (GLuint& texture : m_Textures)
+		texture = unknown;
+}
+
+void GLState::setCapability(GLenum cap, bool enabled)
+{
+	int* state = nullptr;
+	for (size_t i = 0; i < sizeof(trackedCapabilities) / sizeof(trackedCapabilities[0]); i++)
+	{
+		if (trackedCapabilities[i] == cap)
+			state = &m_Capabilities[i];
+	}
+	if (state && *state == (enabled ? 1 : 0))
+		return suppress(Capability);
+
+	if (enabled)
+		glEnable(cap);
+	else
+		glDisable(cap);
+	if (state)
+		*state = enabled ? 1 : 0;
+	issue(Capability);
+}
+
+void GLState::deleteTexture(GLuint texture)
+{
+	glDeleteTextures(1, &texture);
+	for (GLuint& bound : m_Textures)
+	{
+		if (bound == texture)
+			bound = 0;
+	}
+}
+
+void GLState::deleteBuffer(GLuint buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	for (GLuint& bound : m_Buffers)
+	{
+		if (bound == buffer)
+			bound = 0;
+	}
+	for (IndexedBinding& binding : m_UniformBindings)
+	{
+		if (binding.buffer == buffer)
+			binding = { 0, 0, 0 };
+	}
+}
+
+void GLState::deleteVertexArray(GLuint vao)
+{
+	glDeleteVertexArrays(1, &vao);
+	m_BoneArrays.erase(vao);
+	if (m_VertexArray == vao)
+	{
+		m_VertexArray = 0;
+		m_Buffers[ElementArraySlot] = unknown;
+	}
+}
+
+void GLState::boneInputsFor(GLuint vao)
+{
+	auto found = m_BoneArrays.find(vao);
+	if (found == m_BoneArrays.end())
+		return;
+	if (found->second)
+	{
+		// the draws from it may change the current values
+		m_BoneDefaults = false;
+		return;
+	}
+	if (m_BoneDefaults)
+		return suppress(BoneDefaults);
+	// an id of -1 leaves the vertex where it is
+	glVertexAttribI4i(5, -1, -1, -1, -1);
+	glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 0.0f);
+	m_BoneDefaults = true;
+	issue(BoneDefaults);
+}
+
+void GLState::endFrame()
+{
+	m_LastFrame = m_Frame;
+	m_Frame = Counters();
+}
+
+void GLState::printStats() const
+{
+	const Counters& frame = m_LastFrame;
+	std::printf("gl state: %zu calls issued, %zu redundant ones suppressed last frame\n", frame.totalIssued(), frame.totalSuppressed());
+	for (int call = 0; call < CallCount; call++)
+	{
+		if (frame.issued[call] || frame.suppressed[call])
+			std::printf("  %-15s %6zu issued %6zu suppressed\n", callNames[call], frame.issued[call], frame.suppressed[call]);
+	}
+}
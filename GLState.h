@@ -0,0 +1,262 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <unordered_map>
+
+// Shadow of the context state the engine changes: the program, the vertex array, the 2D texture
+// of every unit, the buffer bindings, blend and depth state and the viewport. Every engine call
+// that changes one of these goes through here and only reaches the driver when the value differs
+// from what is bound. State starts out unknown, so the first call of each kind is always issued.
+//
+// Deleting a bound object resets its bindings to 0 in GL, names are then reused, so textures,
+// buffers and vertex arrays are deleted through here too. Code that changes state behind the
+// cache's back has to call invalidate() afterwards. GL thread only.
+//
+// skinnedShader.vert reads the bone inputs (location 5 and 6) of static meshes too. Their arrays are
+// disabled, so it reads the current attribute values, which are context state and not kept in the
+// VAO, and a draw from a skinned VAO leaves them undefined. They are set to an id of -1 whenever a
+// static GeometryPool VAO is bound after anything that could have changed them.
+class GLState
+{
+public:
+	static GLState& instance();
+
+	// kinds of calls, for the counters
+	enum Call
+	{
+		Program,
+		VertexArray,
+		ActiveTexture,
+		Texture,
+		Buffer,
+		BufferRange,
+		Capability,
+		BlendFunc,
+		DepthState,
+		Viewport,
+		BoneDefaults,
+		CallCount
+	};
+
+	struct Counters
+	{
+		size_t issued[CallCount] = {};
+		size_t suppressed[CallCount] = {};
+
+		size_t totalIssued() const;
+		size_t totalSuppressed() const;
+	};
+
+	void useProgram(GLuint program)
+	{
+		if (program == m_Program)
+			return suppress(Program);
+		glUseProgram(program);
+		m_Program = program;
+		issue(Program);
+	}
+
+	void bindVertexArray(GLuint vao)
+	{
+		if (vao == m_VertexArray)
+			return suppress(VertexArray);
+		glBindVertexArray(vao);
+		m_VertexArray = vao;
+		// the element buffer binding belongs to the vertex array
+		m_Buffers[ElementArraySlot] = unknown;
+		issue(VertexArray);
+		if (vao != 0)
+			boneInputsFor(vao);
+	}
+
+	// registers a VAO of the GeometryPool, arrays is whether its bone inputs come from the vertices
+	void setBoneArrays(GLuint vao, bool arrays) { m_BoneArrays[vao] = arrays; }
+
+	void activeTexture(GLenum unit)
+	{
+		if (unit == m_ActiveUnit)
+			return suppress(ActiveTexture);
+		glActiveTexture(unit);
+		m_ActiveUnit = unit;
+		issue(ActiveTexture);
+	}
+
+	// on the active unit. Targets other than GL_TEXTURE_2D aren't tracked and always go through
+	void bindTexture(GLenum target, GLuint texture)
+	{
+		const GLuint unit = m_ActiveUnit - GL_TEXTURE0;
+		if (target != GL_TEXTURE_2D || unit >= maxUnits)
+		{
+			glBindTexture(target, texture);
+			// bound to whatever unit is active, none of them is known anymore
+			if (target == GL_TEXTURE_2D && m_ActiveUnit == unknown)
+				forgetTextures();
+			return issue(Texture);
+		}
+		if (m_Textures[unit] == texture)
+			return suppress(Texture);
+		glBindTexture(target, texture);
+		m_Textures[unit] = texture;
+		issue(Texture);
+	}
+
+	// activeTexture(GL_TEXTURE0 + unit) and bindTexture(GL_TEXTURE_2D, texture), the active unit is
+	// only changed when the texture has to be bound
+	void bindTexture2D(GLuint unit, GLuint texture)
+	{
+		if (unit < maxUnits && m_Textures[unit] == texture)
+			return suppress(Texture);
+		activeTexture(GL_TEXTURE0 + unit);
+		bindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		const int slot = bufferSlot(target);
+		if (slot >= 0 && m_Buffers[slot] == buffer)
+			return suppress(Buffer);
+		glBindBuffer(target, buffer);
+		if (slot >= 0)
+			m_Buffers[slot] = buffer;
+		issue(Buffer);
+	}
+
+	// also binds the buffer to the generic target, like glBindBufferRange
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		const int slot = bufferSlot(target);
+		IndexedBinding* binding = target == GL_UNIFORM_BUFFER && index < maxUniformBindings ? &m_UniformBindings[index] : nullptr;
+		if (binding && binding->buffer == buffer && binding->offset == offset && binding->size == size && m_Buffers[slot] == buffer)
+			return suppress(BufferRange);
+		glBindBufferRange(target, index, buffer, offset, size);
+		if (binding)
+			*binding = { buffer, offset, size };
+		if (slot >= 0)
+			m_Buffers[slot] = buffer;
+		issue(BufferRange);
+	}
+
+	// glEnable/glDisable. Blend, depth, cull, scissor and stencil tests are tracked, other caps always go through
+	void enable(GLenum cap) { setCapability(cap, true); }
+	void disable(GLenum cap) { setCapability(cap, false); }
+
+	void blendFunc(GLenum source, GLenum destination)
+	{
+		if (m_BlendSource == source && m_BlendDestination == destination)
+			return suppress(BlendFunc);
+		glBlendFunc(source, destination);
+		m_BlendSource = source;
+		m_BlendDestination = destination;
+		issue(BlendFunc);
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (m_DepthFunc == func)
+			return suppress(DepthState);
+		glDepthFunc(func);
+		m_DepthFunc = func;
+		issue(DepthState);
+	}
+
+	void depthMask(GLboolean mask)
+	{
+		if (m_DepthMask == mask)
+			return suppress(DepthState);
+		glDepthMask(mask);
+		m_DepthMask = mask;
+		issue(DepthState);
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (m_Viewport[0] == x && m_Viewport[1] == y && m_Viewport[2] == width && m_Viewport[3] == height)
+			return suppress(Viewport);
+		glViewport(x, y, width, height);
+		m_Viewport[0] = x;
+		m_Viewport[1] = y;
+		m_Viewport[2] = width;
+		m_Viewport[3] = height;
+		issue(Viewport);
+	}
+
+	// delete the object and forget every binding of its name, GL has reset them to 0
+	void deleteTexture(GLuint texture);
+	void deleteBuffer(GLuint buffer);
+	void deleteVertexArray(GLuint vao);
+
+	// forgets everything, the next call of every kind is issued
+	void invalidate();
+
+	// closes the frame's counters, call once per frame after the last draw
+	void endFrame();
+	// the last finished frame
+	const Counters& frameCounters() const { return m_LastFrame; }
+	void printStats() const;
+
+private:
+	GLState();
+
+	static const GLuint unknown = 0xFFFFFFFF;
+	static const GLuint maxUnits = 32;
+	static const GLuint maxUniformBindings = 16;
+
+	enum BufferSlot
+	{
+		ArraySlot,
+		ElementArraySlot,
+		UniformSlot,
+		PixelUnpackSlot,
+		DrawIndirectSlot,
+		BufferSlotCount
+	};
+
+	static int bufferSlot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER: return ArraySlot;
+		case GL_ELEMENT_ARRAY_BUFFER: return ElementArraySlot;
+		case GL_UNIFORM_BUFFER: return UniformSlot;
+		case GL_PIXEL_UNPACK_BUFFER: return PixelUnpackSlot;
+		case GL_DRAW_INDIRECT_BUFFER: return DrawIndirectSlot;
+		default: return -1;
+		}
+	}
+
+	void setCapability(GLenum cap, bool enabled);
+	void forgetTextures();
+	void boneInputsFor(GLuint vao);
+
+	void issue(Call call) { m_Frame.issued[call]++; }
+	void suppress(Call call) { m_Frame.suppressed[call]++; }
+
+	struct IndexedBinding
+	{
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	// unknown, or -1, wherever the value isn't known
+	GLuint m_Program;
+	GLuint m_VertexArray;
+	GLenum m_ActiveUnit;
+	GLuint m_Textures[maxUnits];
+	GLuint m_Buffers[BufferSlotCount];
+	IndexedBinding m_UniformBindings[maxUniformBindings];
+	int m_Capabilities[5];  // -1 unknown, 0 disabled, 1 enabled
+	GLenum m_BlendSource, m_BlendDestination;
+	GLenum m_DepthFunc;
+	GLboolean m_DepthMask;
+	GLint m_Viewport[4];
+	std::unordered_map<GLuint, bool> m_BoneArrays;  // the pool's VAOs, by whether they have bone arrays
+	bool m_BoneDefaults;  // the current values of location 5 and 6 are the static ones
+
+	Counters m_Frame, m_LastFrame;
+};
+
+#endif
@@ -52,7 +52,7 @@ void Game::init()
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    GLState::instance().enable(GL_DEPTH_TEST);
 
     //Camera movement speed
     camera.MovementSpeed = 20.f;
@@ -62,22 +62,42 @@ void Game::init()
 
     Renderer renderer;
 
-    Shader lightingShader("LightingShader.vert", "LightingShader.frag");
-    Shader characterShader("characterShader.vert", "characterShader.frag");
-    Shader textShader("textShader.vert", "textShader.frag");
-    Shader hearthShader("hearthShader.vert", "hearthShader.frag");
-    Shader modelShader("modelShader.vert", "modelShader.frag");
-
-    Model ourModel("bird/bird.obj");
-    Model corridorModel("untitled.obj");
-    Model hearthModel("hearth2.obj");
-
-    Animation fly("bird/fly.dae", &ourModel);
-    Animator animator(&fly);
-
-    Entity birdEntity(ourModel);
-    Entity corridorEntity(corridorModel);
-    Entity hearthEntity(hearthModel);
+    // the driver compiles the programs while the assets load, each is checked on its first use
+    ShaderBuildQueue& shaders = ShaderBuildQueue::instance();
+    Shader lightingShader(shaders.submit("LightingShader.vert", "LightingShader.frag"));
+    Shader characterShader(shaders.submit("characterShader.vert", "characterShader.frag"));
+    Shader textShader(shaders.submit("textShader.vert", "textShader.frag"));
+    Shader hearthShader(shaders.submit("hearthShader.vert", "hearthShader.frag"));
+    Shader modelShader(shaders.submit("modelShader.vert", "modelShader.frag"));
+    // the animated character, its bones come from the BonePalette
+    Shader skinnedShader(shaders.submit("skinnedShader.vert", "modelShader.frag"));
+    // the entities' variants, drawn instanced by the render queue
+    Shader lightingInstancedShader(shaders.submit("LightingShaderInstanced.vert", "LightingShader.frag"));
+    Shader modelInstancedShader(shaders.submit("modelShaderInstanced.vert", "modelShader.frag"));
+
+    // load the startup assets concurrently, only the animation has to wait for the bird's skeleton
+    AssetLoader loader;
+    std::unique_ptr<Model> ourModel, corridorModel, hearthModel;
+    std::unique_ptr<Animation> fly;
+    unsigned int wallMap, rockMap, birdTexture, hearthTexture;
+
+    AssetLoader::AssetId birdAsset = loader.addModel("bird/bird.obj", ourModel);
+    loader.addModel("untitled.obj", corridorModel);
+    loader.addModel("hearth2.obj", hearthModel);
+    loader.addAnimation("bird/fly.dae", ourModel, birdAsset, fly);
+    loader.addTexture("wall.jpg", wallMap);
+    loader.addTexture("_Carrera_Marble_1.jpg", rockMap);
+    loader.addTexture("bird/txtr01.jpg", birdTexture);
+    loader.addTexture("hearth.jpg", hearthTexture);
+    loader.run();
+    loader.printTimeline();
+    ShaderCache::printStats();
+
+    Animator animator(fly.get());
+
+    Entity birdEntity(*ourModel);
+    Entity corridorEntity(*corridorModel);
+    Entity hearthEntity(*hearthModel);
 
     
     birdEntity.locAndScale( glm::vec3(0.0f, -1.0f, -4.0f), 0.1f);
@@ -95,39 +115,30 @@ void Game::init()
 
 
     //lighting shader settings
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);
     // be sure to activate shader when setting uniforms/drawing objects
     lightingShader.use();
-    lightingShader.setVec3("light.position", camera.Position + glm::vec3(0.0f, -1.0f, -4.0f));
-    lightingShader.setVec3("light.direction", camera.Front + glm::vec3(0.0f, -1.0f, -4.0f));
-    lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(35.0f)));
-    lightingShader.setFloat("light.outerCutOff", glm::cos(glm::radians(75.0f)));
-    lightingShader.setVec3("viewPos", camera.Position);
-
-    // light properties
-    lightingShader.setVec3("light.ambient", 25.0f, 25.0f, 25.0f);
-    lightingShader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-    lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-    lightingShader.setFloat("light.constant", 1.0f);
-    lightingShader.setFloat("light.linear", 0.09f);
-    lightingShader.setFloat("light.quadratic", 0.032f);
-
-    // material properties
-    lightingShader.setFloat("material.shininess", 32.0f);
+    lightingShader.setInt("material.diffuse", 0);
+    lightingShader.setInt("material.specular", 1);
+    lightingInstancedShader.use();
+    lightingInstancedShader.setInt("material.diffuse", 0);
+    lightingInstancedShader.setInt("material.specular", 1);
 
-    // load and create a texture 
-// -------------------------
+    // light properties, uploaded with the camera every frame, see FrameUniforms
+    renderer.frameUniforms.light.offset = glm::vec3(0.0f, -1.0f, -4.0f);
+    renderer.frameUniforms.light.ambient = glm::vec3(25.0f, 25.0f, 25.0f);
+    renderer.frameUniforms.light.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+    renderer.frameUniforms.light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    renderer.frameUniforms.light.constant = 1.0f;
+    renderer.frameUniforms.light.linear = 0.09f;
+    renderer.frameUniforms.light.quadratic = 0.032f;
 
-    unsigned int wallMap = renderer.loadTexture("wall.jpg");
-    unsigned int rockMap = renderer.loadTexture("_Carrera_Marble_1.jpg");
-    unsigned int birdTexture = renderer.loadTexture("bird/txtr01.jpg");
-    unsigned int hearthTexture = renderer.loadTexture("hearth.jpg");
+    // material properties come from each model's materials, see MaterialTable
 
 
     renderer.setupVAOVBO();
 
     bool flag = false;
+    bool texturesReported = false;
     while (!glfwWindowShouldClose(window))
     {
 
@@ -142,6 +153,20 @@ void Game::init()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // swap in textures that finished decoding since the last frame, create streamed models and evict over budget
+        TextureLoader::instance().processUploads();
+        AssetManager::instance().update();
+        if (!texturesReported && TextureLoader::instance().idle())
+        {
+            TextureLoader::instance().printTimings();
+            TextureCache::instance().printStats();
+            AssetManager::instance().printStats();
+            GeometryPool::instance().printStats();
+            renderer.renderQueue.printStats();
+            GLState::instance().printStats();
+            texturesReported = true;
+        }
+
         // input
          // -----
 
@@ -162,25 +187,29 @@ void Game::init()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // also clear the depth buffer now!
 
+        // camera and light for every program, once per frame
+        renderer.beginFrame();
+
         //Environment
 
         //renderer.renderEnvironment(lightingShader, rockMap);
 
         //Character Model
-        //renderer.renderCharacter(ourModel, modelShader, birdTexture, animator);
+        //renderer.renderCharacter(*ourModel, skinnedShader, birdTexture, animator);
 
 
         
         const Frustum camFrustum = createFrustumFromCamera(camera,(float)SCR_WIDTH / (float)SCR_HEIGHT, glm::radians(camera.Zoom), 0.1f, 10.0f);
 
         if (flag) {
-            renderer.renderSpyViewEntity(corridorEntity, lightingShader, rockMap, camFrustum, 4);
-            renderer.renderSpyViewEntity(birdEntity, modelShader, birdTexture, camFrustum, 1);
+            renderer.renderSpyViewEntity(corridorEntity, lightingInstancedShader, rockMap, camFrustum, 4);
+            renderer.renderSpyViewEntity(birdEntity, modelInstancedShader, birdTexture, camFrustum, 1);
         }
         else {
-            renderer.renderEntity(corridorEntity, lightingShader, rockMap, camFrustum, 4);
-            renderer.renderEntity(birdEntity, modelShader, birdTexture, camFrustum, 1);
+            renderer.renderEntity(corridorEntity, lightingInstancedShader, rockMap, camFrustum, 4);
+            renderer.renderEntity(birdEntity, modelInstancedShader, birdTexture, camFrustum, 1);
         }
+        renderer.submitQueue();
 
 
         //Render HUD
@@ -229,6 +258,8 @@ void Game::init()
 
 
 
+        GLState::instance().endFrame();
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
@@ -246,7 +277,7 @@ void Game::init()
 
 }
 
-void Game::gameLoop(Renderer renderer, Shader lightingShader, Shader modelShader, Shader textShader, Shader hearthShader, Model ourModel, Animator animator, unsigned int wallMap, unsigned int rockMap, unsigned int birdTexture)
+void Game::gameLoop(Renderer renderer, Shader lightingShader, Shader skinnedShader, Shader textShader, Shader hearthShader, Model& ourModel, Animator animator, unsigned int wallMap, unsigned int rockMap, unsigned int birdTexture)
 {
 
 
@@ -272,13 +303,16 @@ void Game::gameLoop(Renderer renderer, Shader lightingShader, Shader modelShader
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // also clear the depth buffer now!
 
+        // camera and light for every program, once per frame
+        renderer.beginFrame();
+
         //Environment
 
         renderer.renderEnvironment(lightingShader, rockMap);
 
 
         //Character Model
-        renderer.renderCharacter(ourModel, modelShader, birdTexture, animator);
+        renderer.renderCharacter(ourModel, skinnedShader, birdTexture, animator);
 
 
 
@@ -286,6 +320,8 @@ void Game::gameLoop(Renderer renderer, Shader lightingShader, Shader modelShader
         renderer.renderHUD(textShader, hearthShader, wallMap);
 
 
+        GLState::instance().endFrame();
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
@@ -333,7 +369,7 @@ void Game::framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    GLState::instance().viewport(0, 0, width, height);
 }
 
 void Game::mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
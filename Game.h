@@ -11,6 +11,10 @@
 #include <GLFW/glfw3.h>
 
 #include "Renderer.h"
+#include "AssetLoader.h"
+#include "AssetManager.h"
+#include "ShaderBuildQueue.h"
+#include "ShaderCache.h"
 
 
 
@@ -52,7 +56,7 @@ public:
 	static void init();
 
 	
-	static void gameLoop(Renderer renderer, Shader lightingShader, Shader modelShader, Shader textShader, Shader hearthShader, Model ourModel, Animator animator, unsigned int wallMap, unsigned int rockMap, unsigned int birdTexture);
+	static void gameLoop(Renderer renderer, Shader lightingShader, Shader skinnedShader, Shader textShader, Shader hearthShader, Model& ourModel, Animator animator, unsigned int wallMap, unsigned int rockMap, unsigned int birdTexture);
 
 	static int processInput(GLFWwindow* window);
 	static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
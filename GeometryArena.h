@@ -0,0 +1,164 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Non-owning view of a contiguous array, used for geometry that lives in a GeometryArena.
+template<typename T>
+class ArrayView
+{
+public:
+	using value_type = std::remove_const_t<T>;
+
+	ArrayView() = default;
+	ArrayView(T* data, size_t size) : m_Data(data), m_Size(size) {}
+	ArrayView(std::vector<value_type>& vector) : m_Data(vector.data()), m_Size(vector.size()) {}
+	template<typename U = T, typename = std::enable_if_t<std::is_const<U>::value>>
+	ArrayView(const std::vector<value_type>& vector) : m_Data(vector.data()), m_Size(vector.size()) {}
+
+	operator ArrayView<const T>() const { return ArrayView<const T>(m_Data, m_Size); }
+
+	T* data() const { return m_Data; }
+	size_t size() const { return m_Size; }
+	bool empty() const { return m_Size == 0; }
+
+	T* begin() const { return m_Data; }
+	T* end() const { return m_Data + m_Size; }
+	T& operator[](size_t i) const { return m_Data[i]; }
+
+private:
+	T* m_Data = nullptr;
+	size_t m_Size = 0;
+};
+
+// Bump allocator that holds all the vertex and index arrays of one model. Arrays are carved out
+// of large chunks back to back and only freed together, by release() or the destructor, so a
+// model's geometry costs a handful of heap blocks with no per-array slack. Pointers stay valid
+// when the arena grows or is moved. allocate() may be called from several threads at once.
+class GeometryArena
+{
+public:
+	// arrays start on this boundary, the same one MeshCache uses in its files
+	static const size_t alignment = 16;
+	static const size_t defaultChunkSize = 256 * 1024;
+
+	explicit GeometryArena(size_t chunkSize = defaultChunkSize) : m_ChunkSize(chunkSize) {}
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	GeometryArena(GeometryArena&& other) noexcept { *this = std::move(other); }
+	GeometryArena& operator=(GeometryArena&& other) noexcept
+	{
+		if (this != &other)
+		{
+			m_Chunks = std::move(other.m_Chunks);
+			m_ChunkSize = other.m_ChunkSize;
+			m_Reserved = other.m_Reserved;
+			m_Used = other.m_Used;
+			other.m_Chunks.clear();
+			other.m_Reserved = other.m_Used = 0;
+		}
+		return *this;
+	}
+
+	// makes sure the next bytes can be allocated from a single chunk, for callers that know their total up front
+	void reserve(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (bytes && (m_Chunks.empty() || m_Chunks.back().size - m_Chunks.back().used < bytes))
+			addChunk(bytes, true);
+	}
+
+	// uninitialized storage for count elements
+	template<typename T>
+	ArrayView<T> allocate(size_t count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+			"the arena never runs constructors or destructors");
+		static_assert(alignof(T) <= alignment, "the arena aligns arrays to 16 bytes");
+		if (count == 0)
+			return ArrayView<T>();
+		return ArrayView<T>(static_cast<T*>(allocateBytes(count * sizeof(T))), count);
+	}
+
+	template<typename T>
+	ArrayView<T> copy(const T* data, size_t count)
+	{
+		ArrayView<T> view = allocate<T>(count);
+		if (count)
+			std::memcpy(view.data(), data, count * sizeof(T));
+		return view;
+	}
+
+	template<typename T>
+	ArrayView<T> copy(const std::vector<T>& vector) { return copy(vector.data(), vector.size()); }
+
+	// frees every chunk, all views handed out become invalid
+	void release()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Chunks.clear();
+		m_Reserved = m_Used = 0;
+	}
+
+	// heap bytes held by the chunks and the part of them handed out
+	size_t reservedBytes() const { return m_Reserved; }
+	size_t usedBytes() const { return m_Used; }
+	size_t chunkCount() const { return m_Chunks.size(); }
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<unsigned char[]> data;
+		size_t size = 0;
+		size_t used = 0;
+	};
+
+	std::vector<Chunk> m_Chunks;
+	size_t m_ChunkSize;
+	size_t m_Reserved = 0;
+	size_t m_Used = 0;
+	std::mutex m_Mutex;
+
+	void* allocateBytes(size_t bytes)
+	{
+		bytes = (bytes + alignment - 1) & ~(alignment - 1);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Chunk* chunk = m_Chunks.empty() ? nullptr : &m_Chunks.back();
+		if (!chunk || chunk->size - chunk->used < bytes)
+		{
+			// arrays bigger than a chunk get a block of their own, the open chunk stays open for the
+			// small ones. Otherwise the tail of the open chunk is given up, less than a chunk's worth.
+			chunk = &addChunk(std::max(bytes, m_ChunkSize), bytes <= m_ChunkSize);
+		}
+
+		void* p = chunk->data.get() + chunk->used;
+		chunk->used += bytes;
+		m_Used += bytes;
+		return p;
+	}
+
+	// the open chunk, the one small arrays are carved from, is always the last one
+	Chunk& addChunk(size_t bytes, bool open)
+	{
+		Chunk chunk;
+		chunk.size = bytes;
+		// new[] aligns to __STDCPP_DEFAULT_NEW_ALIGNMENT__, 16 on every platform we build for
+		chunk.data.reset(new unsigned char[chunk.size]);
+		m_Reserved += chunk.size;
+		if (!open && !m_Chunks.empty())
+			return *m_Chunks.insert(m_Chunks.end() - 1, std::move(chunk));
+		m_Chunks.push_back(std::move(chunk));
+		return m_Chunks.back();
+	}
+};
+
+#endif
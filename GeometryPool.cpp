@@ -0,0 +1,222 @@
+#include "GeometryPool.h"
+#include "GLState.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstdio>
+
+bool GeometryPool::Space::take(uint32_t count, uint32_t& offset)
+{
+	for (size_t i = 0; i < free.size(); i++)
+	{
+		Range& range = free[i];
+		if (range.count < count)
+			continue;
+		offset = range.offset;
+		range.offset += count;
+		range.count -= count;
+		if (range.count == 0)
+			free.erase(free.begin() + i);
+		used += count;
+		return true;
+	}
+	if (capacity - end < count)
+		return false;
+	offset = end;
+	end += count;
+	used += count;
+	return true;
+}
+
+void GeometryPool::Space::release(Range range)
+{
+	used -= range.count;
+	auto next = std::lower_bound(free.begin(), free.end(), range.offset, [](const Range& r, uint32_t offset) { return r.offset < offset; });
+	// merge with the neighbours so a larger mesh fits later
+	if (next != free.end() && range.offset + range.count == next->offset)
+	{
+		range.count += next->count;
+		next = free.erase(next);
+	}
+	if (next != free.begin() && (next - 1)->offset + (next - 1)->count == range.offset)
+	{
+		--next;
+		next->count += range.count;
+		range = *next;
+		next = free.erase(next);
+	}
+	// the tail goes back to the unallocated end
+	if (range.offset + range.count == end)
+		end = range.offset;
+	else
+		free.insert(next, range);
+}
+
+GeometryPool& GeometryPool::instance()
+{
+	static GeometryPool pool;
+	return pool;
+}
+
+uint32_t GeometryPool::findPool(const VertexLayout& layout, GLenum indexType)
+{
+	for (uint32_t i = 0; i < m_Pools.size(); i++)
+	{
+		if (m_Pools[i].layoutFlags == layout.flags && m_Pools[i].indexType == indexType)
+			return i;
+	}
+
+	Pool pool;
+	pool.layoutFlags = layout.flags;
+	pool.indexType = indexType;
+	pool.stride = layout.stride();
+	pool.indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	glGenVertexArrays(1, &pool.vao);
+	GLState::instance().setBoneArrays(pool.vao, layout.has(VertexLayout::Skinned));
+	m_Pools.push_back(pool);
+	return static_cast<uint32_t>(m_Pools.size() - 1);
+}
+
+// moves the pool into buffers that fit vertexCount and indexCount more
+void GeometryPool::grow(Pool& pool, uint32_t vertexCount, uint32_t indexCount)
+{
+	const uint32_t vertexCapacity = std::max({ initialVertices, pool.vertices.capacity * 2, pool.vertices.end + vertexCount });
+	const uint32_t indexCapacity = std::max({ initialIndices, pool.indices.capacity * 2, pool.indices.end + indexCount });
+	if (pool.vbo)
+		m_Growths++;
+	resize(pool, vertexCapacity, indexCapacity);
+}
+
+// gives memory back after a free: an empty pool drops its buffers, one whose live ranges end in the
+// first quarter moves into buffers half the size. Ranges below end keep their offsets either way
+void GeometryPool::shrink(Pool& pool)
+{
+	if (pool.slices == 0)
+	{
+		GLState::instance().deleteBuffer(pool.vbo);
+		GLState::instance().deleteBuffer(pool.ebo);
+		pool.vbo = pool.ebo = 0;
+		pool.vertices = Space();
+		pool.indices = Space();
+		m_Shrinks++;
+		return;
+	}
+
+	auto target = [](const Space& space, uint32_t initial)
+	{
+		if (space.capacity <= initial || space.end > space.capacity / 4)
+			return space.capacity;
+		return std::max(initial, space.capacity / 2);
+	};
+	const uint32_t vertexCapacity = target(pool.vertices, initialVertices);
+	const uint32_t indexCapacity = target(pool.indices, initialIndices);
+	if (vertexCapacity == pool.vertices.capacity && indexCapacity == pool.indices.capacity)
+		return;
+	resize(pool, vertexCapacity, indexCapacity);
+	m_Shrinks++;
+}
+
+// moves the pool's contents below end into new buffers of the given capacities, the VAO is pointed at them
+void GeometryPool::resize(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	GLState& state = GLState::instance();
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	const GLuint old[2] = { pool.vbo, pool.ebo };
+	const GLsizeiptr sizes[2] = { GLsizeiptr(vertexCapacity) * pool.stride, GLsizeiptr(indexCapacity) * pool.indexSize };
+	const GLsizeiptr used[2] = { GLsizeiptr(pool.vertices.end) * pool.stride, GLsizeiptr(pool.indices.end) * pool.indexSize };
+	for (int i = 0; i < 2; i++)
+	{
+		state.bindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizes[i], nullptr, GL_STATIC_DRAW);
+		if (old[i])
+		{
+			state.bindBuffer(GL_COPY_READ_BUFFER, old[i]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used[i]);
+			state.deleteBuffer(old[i]);
+		}
+	}
+	pool.vbo = buffers[0];
+	pool.ebo = buffers[1];
+	pool.vertices.capacity = vertexCapacity;
+	pool.indices.capacity = indexCapacity;
+
+	state.bindVertexArray(pool.vao);
+	state.bindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+	VertexLayout(pool.layoutFlags).apply();
+	state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+}
+
+GeometrySlice GeometryPool::allocate(const VertexLayout& layout, GLenum indexType, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount)
+{
+	const uint32_t index = findPool(layout, indexType);
+	Pool& pool = m_Pools[index];
+
+	GeometrySlice slice;
+	uint32_t firstVertex = 0;
+	auto take = [&]()
+	{
+		if (!pool.vertices.take(vertexCount, firstVertex))
+			return false;
+		if (pool.indices.take(indexCount, slice.firstIndex))
+			return true;
+		pool.vertices.release({ firstVertex, vertexCount });
+		return false;
+	};
+	if (!take())
+	{
+		grow(pool, vertexCount, indexCount);
+		take();
+	}
+
+	GLState& state = GLState::instance();
+	state.bindBuffer(GL_COPY_WRITE_BUFFER, pool.vbo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(firstVertex) * pool.stride, GLsizeiptr(vertexCount) * pool.stride, vertices);
+	state.bindBuffer(GL_COPY_WRITE_BUFFER, pool.ebo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(slice.firstIndex) * pool.indexSize, GLsizeiptr(indexCount) * pool.indexSize, indices);
+
+	slice.pool = index;
+	slice.vao = pool.vao;
+	slice.baseVertex = static_cast<GLint>(firstVertex);
+	slice.vertexCount = vertexCount;
+	slice.indexCount = indexCount;
+	pool.slices++;
+	return slice;
+}
+
+void GeometryPool::free(GeometrySlice& slice)
+{
+	if (!slice.valid())
+		return;
+	Pool& pool = m_Pools[slice.pool];
+	pool.vertices.release({ static_cast<uint32_t>(slice.baseVertex), slice.vertexCount });
+	pool.indices.release({ slice.firstIndex, slice.indexCount });
+	pool.slices--;
+	slice = GeometrySlice();
+	shrink(pool);
+}
+
+GeometryPool::Stats GeometryPool::stats() const
+{
+	Stats stats;
+	stats.pools = m_Pools.size();
+	stats.growths = m_Growths;
+	stats.shrinks = m_Shrinks;
+	for (const Pool& pool : m_Pools)
+	{
+		stats.bufferBytes += size_t(pool.vertices.capacity) * pool.stride + size_t(pool.indices.capacity) * pool.indexSize;
+		stats.usedBytes += pool.vertices.used * pool.stride + pool.indices.used * pool.indexSize;
+		stats.slices += pool.slices;
+	}
+	return stats;
+}
+
+void GeometryPool::printStats() const
+{
+	const Stats s = stats();
+	std::printf("geometry pool: %zu meshes in %zu pools, %.1f of %.1f MB used, grown %zu times, shrunk %zu times\n",
+		s.slices, s.pools, s.usedBytes / (1024.0 * 1024.0), s.bufferBytes / (1024.0 * 1024.0), s.growths, s.shrinks);
+	for (const Pool& pool : m_Pools)
+		std::printf("  %-28s %-6s %6zu meshes %8u/%u vertices %9u/%u indices\n", VertexLayout(pool.layoutFlags).describe().c_str(),
+			pool.indexType == GL_UNSIGNED_SHORT ? "16 bit" : "32 bit", pool.slices, pool.vertices.end, pool.vertices.capacity, pool.indices.end, pool.indices.capacity);
+}
@@ -0,0 +1,104 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct VertexLayout;
+
+// where a mesh's vertices and indices live in the GeometryPool
+struct GeometrySlice
+{
+	uint32_t pool = 0xFFFFFFFF;
+	GLuint vao = 0;            // the pool's, shared by every mesh in it
+	GLint baseVertex = 0;      // added to every index of the mesh
+	GLuint firstIndex = 0;     // in indices of the pool's type
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+
+	bool valid() const { return pool != 0xFFFFFFFF; }
+};
+
+// One vertex buffer, element buffer and VAO per vertex layout and index type, every mesh of that
+// format suballocated from them. Indices stay relative to the mesh and are drawn with its base
+// vertex, so 16 bit indices keep working however many meshes share a pool. Meshes of one pool
+// only differ in their offsets, consecutive draws need no VAO bind and can be merged into one
+// multi draw, see RenderQueue.
+//
+// A full pool grows into buffers twice the size and copies its contents over on the GPU, the VAO
+// and every slice's offsets stay the same. Freed ranges are reused first fit. Frees give memory
+// back from the end: a pool whose live ranges all sit in the first quarter of its buffers moves
+// into buffers half the size, an empty pool drops them, so evicting models shrinks the GPU
+// footprint. Ranges are never moved, a live slice near the end keeps the buffers large. GL thread only.
+class GeometryPool
+{
+public:
+	static GeometryPool& instance();
+
+	// copies vertices, packed in the layout, and indices, already of indexType, into the pool of
+	// that format
+	GeometrySlice allocate(const VertexLayout& layout, GLenum indexType, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount);
+	// hands the slice's ranges back for later meshes, the slice is invalid afterwards
+	void free(GeometrySlice& slice);
+
+	struct Stats
+	{
+		size_t pools = 0;
+		size_t bufferBytes = 0;  // vertex and element buffers allocated
+		size_t usedBytes = 0;    // taken by live slices
+		size_t slices = 0;
+		size_t growths = 0;
+		size_t shrinks = 0;
+	};
+	Stats stats() const;
+	void printStats() const;
+
+private:
+	GeometryPool() = default;
+
+	static const uint32_t initialVertices = 1 << 16;
+	static const uint32_t initialIndices = 1 << 18;
+
+	struct Range
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// a buffer's allocation state, in elements
+	struct Space
+	{
+		uint32_t capacity = 0;
+		uint32_t end = 0;           // everything from here on is free
+		std::vector<Range> free;    // below end, sorted by offset, never adjacent
+		size_t used = 0;
+
+		bool take(uint32_t count, uint32_t& offset);
+		void release(Range range);
+	};
+
+	struct Pool
+	{
+		unsigned int layoutFlags;
+		GLenum indexType;
+		GLuint stride;
+		GLuint indexSize;
+		GLuint vao = 0, vbo = 0, ebo = 0;
+		Space vertices, indices;
+		size_t slices = 0;
+	};
+
+	uint32_t findPool(const VertexLayout& layout, GLenum indexType);
+	void grow(Pool& pool, uint32_t vertexCount, uint32_t indexCount);
+	void shrink(Pool& pool);
+	void resize(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity);
+
+	std::vector<Pool> m_Pools;
+	size_t m_Growths = 0;
+	size_t m_Shrinks = 0;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "KtxTexture.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t ktxEndianness = 0x04030201;
+
+	struct KtxHeader
+	{
+		unsigned char identifier[12];
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	size_t blockBytes(uint32_t internalFormat)
+	{
+		return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	}
+}
+
+bool KtxTexture::isKtx(const unsigned char* bytes, size_t size)
+{
+	return size >= sizeof(ktxIdentifier) && std::memcmp(bytes, ktxIdentifier, sizeof(ktxIdentifier)) == 0;
+}
+
+bool KtxTexture::parse(const unsigned char* bytes, size_t size)
+{
+	KtxHeader header;
+	if (!isKtx(bytes, size) || size < sizeof(header))
+		return false;
+	std::memcpy(&header, bytes, sizeof(header));
+
+	if (header.endianness != ktxEndianness
+		|| header.glType != 0 || header.pixelDepth != 0 || header.numberOfArrayElements != 0 || header.numberOfFaces != 1
+		|| (header.glInternalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.glInternalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		|| header.numberOfMipmapLevels == 0 || header.pixelWidth == 0 || header.pixelHeight == 0)
+		return false;
+
+	size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+	internalFormat = header.glInternalFormat;
+	baseInternalFormat = header.glBaseInternalFormat;
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	levels.clear();
+	data.clear();
+
+	uint32_t levelWidth = width, levelHeight = height;
+	for (uint32_t i = 0; i < header.numberOfMipmapLevels; i++)
+	{
+		uint32_t imageSize;
+		if (offset + sizeof(imageSize) > size)
+			return false;
+		std::memcpy(&imageSize, bytes + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+
+		const size_t expected = size_t((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes(internalFormat);
+		if (imageSize != expected || offset + imageSize > size)
+			return false;
+
+		levels.push_back({ levelWidth, levelHeight, data.size(), imageSize });
+		data.insert(data.end(), bytes + offset, bytes + offset + imageSize);
+		// block sizes are multiples of 4, so there is never any mip padding
+		offset += imageSize;
+
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	return true;
+}
+
+bool KtxTexture::write(const std::string& path) const
+{
+	KtxHeader header;
+	std::memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+	header.endianness = ktxEndianness;
+	header.glType = 0;
+	header.glTypeSize = 1;
+	header.glFormat = 0;
+	header.glInternalFormat = internalFormat;
+	header.glBaseInternalFormat = baseInternalFormat;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.pixelDepth = 0;
+	header.numberOfArrayElements = 0;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = static_cast<uint32_t>(levels.size());
+	header.bytesOfKeyValueData = 0;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const KtxLevel& level : levels)
+	{
+		uint32_t imageSize = static_cast<uint32_t>(level.size);
+		out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+		out.write(reinterpret_cast<const char*>(data.data() + level.offset), level.size);
+	}
+	return static_cast<bool>(out);
+}
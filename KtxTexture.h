@@ -0,0 +1,48 @@
+#ifndef KTX_TEXTURE_H
+#define KTX_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// S3TC formats are an extension, not every glad build declares them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// One mip level inside KtxTexture::data
+struct KtxLevel
+{
+	uint32_t width;
+	uint32_t height;
+	size_t offset;
+	size_t size;
+};
+
+// 2D texture in the KTX 1.1 container with a complete, precompressed mip chain, as written by
+// TextureCooker. Only the subset we produce is supported: one face, no array layers, no
+// key/value data, block compressed internal format.
+struct KtxTexture
+{
+	uint32_t internalFormat = 0;      // GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	uint32_t baseInternalFormat = 0;  // GL_RGB or GL_RGBA
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<KtxLevel> levels;
+	std::vector<unsigned char> data;  // all levels back to back, largest first
+
+	static bool isKtx(const unsigned char* bytes, size_t size);
+
+	// parses a file already in memory, false if it isn't a KTX we can upload
+	bool parse(const unsigned char* bytes, size_t size);
+	bool write(const std::string& path) const;
+
+	size_t byteSize() const { return data.size(); }
+};
+
+#endif
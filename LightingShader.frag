@@ -1,52 +1,57 @@
 #version 330 core
 out vec4 FragColor;
 
-struct Material {
+struct MaterialMaps {
     sampler2D diffuse;
-    sampler2D specular;    
-    float shininess;
-}; 
+    sampler2D specular;
+};
 
-struct Light {
-    vec3 position;  
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-	
-    float constant;
-    float linear;
-    float quadratic;
+// this mesh's slot of the MaterialTable
+layout (std140) uniform Material
+{
+    vec4 materialDiffuse;
+    vec4 materialSpecular;
+    float materialShininess;
+};
+
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
 };
 
 in vec3 FragPos;  
 in vec3 Normal;  
 in vec2 TexCoords;
   
-uniform vec3 viewPos;
-uniform Material material;
-uniform Light light;
+uniform MaterialMaps material;
 
 void main()
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = lightAmbient.rgb * texture(material.diffuse, TexCoords).rgb;
   	
     // diffuse 
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(lightPosition.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;  
+    vec3 diffuse = lightDiffuse.rgb * diff * texture(material.diffuse, TexCoords).rgb;  
     
     // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);  
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), materialShininess);
+    vec3 specular = lightSpecular.rgb * spec * texture(material.specular, TexCoords).rgb;  
     
     // attenuation
-    float distance    = length(light.position - FragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    float distance    = length(lightPosition.xyz - FragPos);
+    float attenuation = 1.0 / (lightAttenuation.x + lightAttenuation.y * distance + lightAttenuation.z * (distance * distance));    
 
     ambient  *= attenuation;  
     diffuse   *= attenuation;
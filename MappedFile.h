@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The contents are served straight
+// from the OS page cache, so nothing is copied until the caller reads it.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// maps the file, returns false if it does not exist or cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return m_Data != nullptr; }
+	const unsigned char* data() const { return m_Data; }
+	size_t size() const { return m_Size; }
+
+private:
+	const unsigned char* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
+
+#endif
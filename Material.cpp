@@ -0,0 +1,141 @@
+#include "Material.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstring>
+
+MaterialTable& MaterialTable::instance()
+{
+	static MaterialTable table;
+	return table;
+}
+
+uint32_t MaterialTable::allocate(const MaterialConstants& constants)
+{
+	if (!m_Stride)
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_Stride = (static_cast<GLsizeiptr>(sizeof(MaterialConstants)) + alignment - 1) / alignment * alignment;
+	}
+
+	uint32_t slot;
+	if (!m_FreeSlots.empty())
+	{
+		slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_Staging.size() / m_Stride);
+		m_Staging.resize(m_Staging.size() + m_Stride, 0);
+	}
+	std::memcpy(m_Staging.data() + slot * m_Stride, &constants, sizeof(MaterialConstants));
+	m_Live++;
+	m_Dirty = true;
+	return slot;
+}
+
+void MaterialTable::release(uint32_t slot)
+{
+	m_FreeSlots.push_back(slot);
+	m_Live--;
+}
+
+void MaterialTable::upload()
+{
+	GLState& state = GLState::instance();
+	const size_t slots = m_Staging.size() / m_Stride;
+	if (slots > m_Capacity)
+	{
+		// a new name, so no binding is left pointing at the smaller store
+		if (m_Buffer)
+			state.deleteBuffer(m_Buffer);
+		glGenBuffers(1, &m_Buffer);
+		m_Capacity = std::max(slots, m_Capacity * 2);
+		state.bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+		glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_Capacity) * m_Stride, nullptr, GL_STATIC_DRAW);
+	}
+	state.bindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(m_Staging.size()), m_Staging.data());
+	m_Dirty = false;
+}
+
+void MaterialTable::bind(uint32_t slot)
+{
+	if (m_Dirty)
+		upload();
+	GLState::instance().bindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer, slot * m_Stride, sizeof(MaterialConstants));
+}
+
+void MaterialTable::bindBlock(GLuint program)
+{
+	const GLuint index = glGetUniformBlockIndex(program, blockName);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, binding);
+}
+
+Material::Material(const MaterialSource& source, const std::vector<Texture>& textures)
+	: m_Constants(source.constants), m_Slot(MaterialTable::instance().allocate(source.constants))
+{
+	// the sampler each texture is bound to, named once so drawing builds no strings
+	unsigned int diffuseNr = 1;
+	unsigned int specularNr = 1;
+	unsigned int normalNr = 1;
+	unsigned int heightNr = 1;
+	for (const Texture& texture : textures)
+	{
+		// retrieve texture number (the N in diffuse_textureN)
+		std::string number;
+		if (texture.type == "texture_diffuse")
+			number = std::to_string(diffuseNr++);
+		else if (texture.type == "texture_specular")
+			number = std::to_string(specularNr++);
+		else if (texture.type == "texture_normal")
+			number = std::to_string(normalNr++);
+		else if (texture.type == "texture_height")
+			number = std::to_string(heightNr++);
+		m_Bindings.push_back({ texture.id, UniformName(texture.type + number) });
+	}
+}
+
+void Material::bind(const Shader& shader) const
+{
+	GLState& state = GLState::instance();
+	for (GLuint unit = 0; unit < m_Bindings.size(); unit++)
+	{
+		shader.setInt(m_Bindings[unit].sampler, static_cast<int>(unit));
+		state.bindTexture2D(unit, m_Bindings[unit].texture);
+	}
+	MaterialTable::instance().bind(m_Slot);
+}
+
+unsigned int Material::bind(const Shader& shader, std::vector<GLuint>& units, GLuint fallback) const
+{
+	unsigned int bound = 0;
+	auto bindUnit = [&](GLuint unit, GLuint texture)
+	{
+		// units past the end hold something unknown
+		if (units.size() <= unit)
+			units.resize(unit + 1, 0xFFFFFFFF);
+		if (units[unit] == texture)
+			return;
+		GLState::instance().bindTexture2D(unit, texture);
+		units[unit] = texture;
+		bound++;
+	};
+	if (m_Bindings.empty())
+		bindUnit(0, fallback);
+	for (GLuint unit = 0; unit < m_Bindings.size(); unit++)
+	{
+		shader.setInt(m_Bindings[unit].sampler, static_cast<int>(unit));
+		bindUnit(unit, m_Bindings[unit].texture);
+	}
+	MaterialTable::instance().bind(m_Slot);
+	return bound;
+}
+
+void Material::release()
+{
+	MaterialTable::instance().release(m_Slot);
+}
@@ -0,0 +1,97 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include "Mesh.h"
+#include "Shader.h"
+#include "UniformTable.h"
+
+#include <cstdint>
+#include <vector>
+
+// The constants of every live material in one std140 uniform buffer, a slot each, read by the
+// programs that declare the Material block below. A material's slot is picked with
+// glBindBufferRange, so switching materials sets no constant uniforms.
+//
+//     layout (std140) uniform Material
+//     {
+//         vec4 materialDiffuse;   // rgb
+//         vec4 materialSpecular;  // rgb
+//         float materialShininess;
+//     };
+//
+// Slots are written to a staging copy and uploaded on the next bind, materials are made while
+// models load, not while drawing. GL thread only.
+class MaterialTable
+{
+public:
+	static constexpr GLuint binding = 2;
+	static constexpr const char* blockName = "Material";
+
+	static MaterialTable& instance();
+
+	// a slot holding the constants, reused after release
+	uint32_t allocate(const MaterialConstants& constants);
+	void release(uint32_t slot);
+
+	// binds the slot's block to the binding point, GLState drops it if it is bound already
+	void bind(uint32_t slot);
+
+	// points the program's Material block, if it has one, at the binding point
+	static void bindBlock(GLuint program);
+
+	size_t size() const { return m_Live; }
+
+private:
+	MaterialTable() = default;
+
+	void upload();
+
+	GLuint m_Buffer = 0;
+	GLsizeiptr m_Stride = 0;
+	size_t m_Capacity = 0;                  // slots the buffer holds
+	std::vector<unsigned char> m_Staging;   // every slot, at the stride
+	std::vector<uint32_t> m_FreeSlots;
+	size_t m_Live = 0;
+	bool m_Dirty = false;
+};
+
+// A mesh's surface, resolved once when its model is created: the texture of every unit and the
+// sampler uniform pointed at it, and the constant parameters in a MaterialTable slot. Meshes
+// refer to their model's materials by index, the RenderQueue batches draws by material.
+class Material
+{
+public:
+	struct Binding
+	{
+		GLuint texture;
+		UniformName sampler;  // "texture_diffuseN" and so on, N counting per type from 1
+	};
+
+	// the source's textures, loaded in the same order
+	Material(const MaterialSource& source, const std::vector<Texture>& textures);
+
+	// unit i gets bindings[i]
+	const std::vector<Binding>& bindings() const { return m_Bindings; }
+	const MaterialConstants& constants() const { return m_Constants; }
+	// unique among live materials
+	uint32_t slot() const { return m_Slot; }
+
+	// points the samplers at their units, binds the textures and the constants
+	void bind(const Shader& shader) const;
+	// the same for a caller that tracks the texture of every unit, units[i] is unit i's texture and
+	// is updated. Textures a unit already holds are skipped, a material without textures puts
+	// fallback on unit 0. Returns how many textures were bound
+	unsigned int bind(const Shader& shader, std::vector<GLuint>& units, GLuint fallback) const;
+
+	// hands the slot back, copies of the material must not be bound afterwards
+	void release();
+
+private:
+	std::vector<Binding> m_Bindings;
+	MaterialConstants m_Constants;
+	uint32_t m_Slot;
+};
+
+#endif
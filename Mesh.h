@@ -5,9 +5,16 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "Shader.h"
+#include "GeometryArena.h"
+#include "GeometryPool.h"
+#include "GLState.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
@@ -31,116 +38,381 @@ struct Vertex {
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// Describes how a mesh's vertices are stored on the GPU. Vertex stays the import format, pack()
+// writes only the attributes the layout keeps, in the encodings it selects. Attribute locations
+// are the same for every layout (0 position, 1 normal, 2 uv, 3 tangent, 4 bitangent, 5 bone ids,
+// 6 weights); attributes a layout drops are left disabled and read as the default (0, 0, 0, 1).
+struct VertexLayout {
+    enum : unsigned int {
+        Skinned       = 1 << 0, // bone ids (16 bit) and weights
+        TangentFrame  = 1 << 1, // tangent and bitangent
+        PackedNormals = 1 << 2, // normal and tangent frame as 10:10:10:2 snorm
+        HalfTexCoords = 1 << 3, // uv as half floats
+        ByteWeights   = 1 << 4, // weights as 8 bit unorm
+        Full          = Skinned | TangentFrame, // same data as the 88 byte Vertex, except 16 bit bone ids
+    };
+
+    struct Attribute {
+        GLuint location;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        bool integer;
+        unsigned int offset;
+    };
+
+    // uv error above this would be visible as a shift on our largest textures
+    static constexpr float maxTexCoordError = 1.0f / 4096.0f;
+
+    unsigned int flags;
+
+    VertexLayout(unsigned int flags = Full) : flags(flags) {}
+
+    bool has(unsigned int flag) const { return (flags & flag) != 0; }
+
+    // the smallest layout that keeps what the mesh uses: bones only when a vertex is weighted,
+    // the tangent frame only with a normal map, half uvs only where they are precise enough
+    static VertexLayout choose(ArrayView<const Vertex> vertices, bool normalMapped)
+    {
+        unsigned int flags = PackedNormals | HalfTexCoords;
+        if (normalMapped)
+            flags |= TangentFrame;
+        for (const Vertex& vertex : vertices)
+        {
+            if (vertex.m_BoneIDs[0] >= 0)
+                flags |= Skinned | ByteWeights;
+            for (int i = 0; i < 2 && (flags & HalfTexCoords); i++)
+            {
+                float uv = vertex.TexCoords[i];
+                if (std::fabs(glm::unpackHalf1x16(glm::packHalf1x16(uv)) - uv) > maxTexCoordError)
+                    flags &= ~HalfTexCoords;
+            }
+        }
+        return VertexLayout(flags);
+    }
+
+    // fills out with the enabled attributes, returns their count
+    unsigned int attributes(Attribute out[7]) const
+    {
+        unsigned int count = 0, offset = 0;
+        auto add = [&](GLuint location, GLint size, GLenum type, GLboolean normalized, bool integer, unsigned int bytes)
+        {
+            out[count++] = { location, size, type, normalized, integer, offset };
+            offset += bytes;
+        };
+
+        const bool packed = has(PackedNormals);
+        add(0, 3, GL_FLOAT, GL_FALSE, false, 12);
+        if (packed)
+            add(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, false, 4);
+        else
+            add(1, 3, GL_FLOAT, GL_FALSE, false, 12);
+        if (has(HalfTexCoords))
+            add(2, 2, GL_HALF_FLOAT, GL_FALSE, false, 4);
+        else
+            add(2, 2, GL_FLOAT, GL_FALSE, false, 8);
+        if (has(TangentFrame))
+        {
+            for (GLuint location = 3; location <= 4; location++)
+            {
+                if (packed)
+                    add(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, false, 4);
+                else
+                    add(location, 3, GL_FLOAT, GL_FALSE, false, 12);
+            }
+        }
+        if (has(Skinned))
+        {
+            // -1 marks an unused influence, so the ids stay signed
+            add(5, 4, GL_SHORT, GL_FALSE, true, 8);
+            if (has(ByteWeights))
+                add(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, false, 4);
+            else
+                add(6, 4, GL_FLOAT, GL_FALSE, false, 16);
+        }
+        return count;
+    }
+
+    unsigned int stride() const
+    {
+        Attribute attribs[7];
+        unsigned int count = attributes(attribs);
+        const Attribute& last = attribs[count - 1];
+        return last.offset + attributeBytes(last);
+    }
+
+    // interleaves the attributes this layout keeps
+    vector<unsigned char> pack(ArrayView<const Vertex> vertices) const
+    {
+        Attribute attribs[7];
+        const unsigned int count = attributes(attribs);
+        const unsigned int vertexStride = stride();
+
+        vector<unsigned char> out(vertices.size() * vertexStride);
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            const Vertex& vertex = vertices[v];
+            unsigned char* dst = &out[v * vertexStride];
+            for (unsigned int a = 0; a < count; a++)
+            {
+                const Attribute& attrib = attribs[a];
+                unsigned char* p = dst + attrib.offset;
+                switch (attrib.location)
+                {
+                case 0: std::memcpy(p, &vertex.Position, sizeof(glm::vec3)); break;
+                case 1: writeDirection(p, attrib, vertex.Normal); break;
+                case 2:
+                    if (attrib.type == GL_HALF_FLOAT)
+                    {
+                        uint16_t uv[2] = { glm::packHalf1x16(vertex.TexCoords.x), glm::packHalf1x16(vertex.TexCoords.y) };
+                        std::memcpy(p, uv, sizeof(uv));
+                    }
+                    else
+                        std::memcpy(p, &vertex.TexCoords, sizeof(glm::vec2));
+                    break;
+                case 3: writeDirection(p, attrib, vertex.Tangent); break;
+                case 4: writeDirection(p, attrib, vertex.Bitangent); break;
+                case 5:
+                {
+                    int16_t ids[MAX_BONE_INFLUENCE];
+                    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+                        ids[i] = static_cast<int16_t>(vertex.m_BoneIDs[i]);
+                    std::memcpy(p, ids, sizeof(ids));
+                    break;
+                }
+                case 6:
+                    if (attrib.type == GL_UNSIGNED_BYTE)
+                        writeByteWeights(p, vertex.m_Weights);
+                    else
+                        std::memcpy(p, vertex.m_Weights, sizeof(vertex.m_Weights));
+                    break;
+                }
+            }
+        }
+        return out;
+    }
+
+    // sets the attribute pointers for the VBO bound to GL_ARRAY_BUFFER, the VAO must be bound
+    void apply() const
+    {
+        Attribute attribs[7];
+        const unsigned int count = attributes(attribs);
+        const GLsizei vertexStride = stride();
+        for (unsigned int a = 0; a < count; a++)
+        {
+            const Attribute& attrib = attribs[a];
+            glEnableVertexAttribArray(attrib.location);
+            if (attrib.integer)
+                glVertexAttribIPointer(attrib.location, attrib.size, attrib.type, vertexStride, (void*)(size_t)attrib.offset);
+            else
+                glVertexAttribPointer(attrib.location, attrib.size, attrib.type, attrib.normalized, vertexStride, (void*)(size_t)attrib.offset);
+        }
+        if (!has(Skinned))
+        {
+            // skinnedShader.vert still reads the bone inputs, GLState sets their current values
+            // whenever a static VAO is bound
+            glDisableVertexAttribArray(5);
+            glDisableVertexAttribArray(6);
+        }
+    }
+
+    string describe() const
+    {
+        string text = has(Skinned) ? "skinned" : "static";
+        if (has(TangentFrame))
+            text += "+tangents";
+        if (has(PackedNormals))
+            text += "+n10";
+        if (has(HalfTexCoords))
+            text += "+uv16";
+        if (has(ByteWeights))
+            text += "+w8";
+        return text;
+    }
+
+private:
+    static unsigned int attributeBytes(const Attribute& attrib)
+    {
+        switch (attrib.type)
+        {
+        case GL_INT_2_10_10_10_REV: return 4;
+        case GL_HALF_FLOAT:
+        case GL_SHORT: return attrib.size * 2;
+        case GL_UNSIGNED_BYTE: return attrib.size;
+        default: return attrib.size * 4;
+        }
+    }
+
+    static void writeDirection(unsigned char* p, const Attribute& attrib, const glm::vec3& direction)
+    {
+        if (attrib.type == GL_INT_2_10_10_10_REV)
+        {
+            uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(direction, 0.0f));
+            std::memcpy(p, &packed, sizeof(packed));
+        }
+        else
+            std::memcpy(p, &direction, sizeof(glm::vec3));
+    }
+
+    // rounds to 8 bits and puts the rounding error on the largest weight so they still sum to 1
+    static void writeByteWeights(unsigned char* p, const float weights[MAX_BONE_INFLUENCE])
+    {
+        int quantized[MAX_BONE_INFLUENCE];
+        int sum = 0, largest = 0;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            quantized[i] = std::clamp(int(weights[i] * 255.0f + 0.5f), 0, 255);
+            sum += quantized[i];
+            if (weights[i] > weights[largest])
+                largest = i;
+        }
+        if (sum > 0)
+            quantized[largest] = std::clamp(quantized[largest] + 255 - sum, 0, 255);
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+            p[i] = static_cast<unsigned char>(quantized[i]);
+    }
+};
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// material texture referenced by a mesh before it has been loaded to the GPU
+struct TextureSource {
+    string type;
+    string path;
+};
+
+// a material's constant parameters, laid out like the std140 Material block, see MaterialTable
+struct MaterialConstants {
+    glm::vec4 diffuse   = glm::vec4(1.0f); // rgb, Kd
+    glm::vec4 specular  = glm::vec4(1.0f); // rgb, Ks
+    float     shininess = 32.0f;           // Ns
+    float     padding[3] = {};
+};
+
+// a material as imported, meshes refer to it by its index in the model
+struct MaterialSource {
+    string                name;
+    vector<TextureSource> textures; // diffuse, specular, normal and height maps, in that order
+    MaterialConstants     constants;
+
+    bool normalMapped() const
+    {
+        return std::any_of(textures.begin(), textures.end(), [](const TextureSource& texture) { return texture.type == "texture_normal"; });
+    }
+};
+
+// meshes up to this many vertices are drawn with 16 bit indices, bigger ones are split at import
+const size_t maxShortIndexVertices = 65536;
+
+// one level of detail, a range of the mesh's element buffer drawn with the same vertices
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    float        error; // largest distance the surface moved from the full mesh, model units
+};
+
+// a mesh while it is being imported, the optimizer and simplifier grow and shrink its arrays
+struct MeshData {
+    vector<Vertex>        vertices;
+    vector<unsigned int>  indices;
+    unsigned int          material = 0; // index into the model's materials
+    VertexLayout          layout;
+    vector<MeshLod>       lods;     // lods[0] is the full mesh, the others follow it in indices
+};
+
+// finished import of a mesh, everything needed to create a Mesh on the GL thread. The arrays
+// live in the model's GeometryArena, copied there once at their final size.
+struct MeshGeometry {
+    ArrayView<Vertex>       vertices;
+    ArrayView<unsigned int> indices;
+    unsigned int            material = 0;
+    VertexLayout            layout;
+    vector<MeshLod>         lods;
+
+    MeshGeometry() = default;
+    MeshGeometry(MeshData& data, GeometryArena& arena)
+        : vertices(arena.copy(data.vertices)), indices(arena.copy(data.indices)),
+          material(data.material), layout(data.layout), lods(std::move(data.lods)) {}
+};
+
 class Mesh {
 public:
-    // mesh Data
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
-    vector<Texture>      textures;
-    unsigned int VAO;
+    // mesh Data, vertices and indices point into the owning Model's GeometryArena and are empty after releaseCpuData()
+    ArrayView<const Vertex>       vertices;
+    ArrayView<const unsigned int> indices;
+    size_t               vertexCount = 0;
+    size_t               indexCount = 0;
+    unsigned int         material;  // index into the owning Model's materials
+    VertexLayout         layout;
+    vector<MeshLod>      lods;
+    GLenum               indexType; // GL_UNSIGNED_SHORT whenever the vertex count allows it
+    GeometrySlice        geometry;  // the vertices and indices in the GeometryPool
+    unsigned int VAO;               // the pool's, shared with every mesh of the same format
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(ArrayView<const Vertex> vertices, ArrayView<const unsigned int> indices, unsigned int material, VertexLayout layout = VertexLayout(), vector<MeshLod> lods = {})
     {
         this->vertices = vertices;
         this->indices = indices;
-        this->textures = textures;
+        this->material = material;
+        this->layout = layout;
+        this->lods = std::move(lods);
+        vertexCount = this->vertices.size();
+        indexCount = this->indices.size();
+        if (this->lods.empty())
+            this->lods.push_back({ 0, static_cast<unsigned int>(indexCount), 0.0f });
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader& shader)
+    // render the mesh, lod is clamped to the levels this mesh has. Its material has to be bound, see Material::bind
+    void Draw(unsigned int lod = 0)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-        for (unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        // draw mesh. The VAO stays bound, whatever draws next binds its own through GLState
+        GLState::instance().bindVertexArray(VAO);
+        const MeshLod& level = lods[std::min<size_t>(lod, lods.size() - 1)];
+        glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, indexType, (void*)(size_t(geometry.firstIndex + level.indexOffset) * indexSize()), geometry.baseVertex);
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    unsigned int indexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // forgets the vertex and index arrays before the model frees its arena, the GPU buffers hold everything drawing needs
+    void releaseCpuData()
+    {
+        vertices = ArrayView<const Vertex>();
+        indices = ArrayView<const unsigned int>();
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
+    // hands the mesh's ranges back to the GeometryPool, copies of the mesh must not draw afterwards
+    void releaseGpuData()
+    {
+        GeometryPool::instance().free(geometry);
+        VAO = 0;
+    }
+
+    size_t gpuBytes() const { return vertexCount * layout.stride() + indexCount * indexSize(); }
 
-    // initializes all the buffer objects/arrays
+private:
+    // copies the vertices and indices into the GeometryPool of the mesh's layout and index type
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        // ids
-        glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-        // weights
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        vector<unsigned char> packed = layout.pack(vertices);
+        const uint32_t vertexTotal = static_cast<uint32_t>(vertices.size());
+        const uint32_t indexTotal = static_cast<uint32_t>(indices.size());
+        indexType = vertices.size() <= maxShortIndexVertices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        if (indexType == GL_UNSIGNED_SHORT)
+        {
+            vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            geometry = GeometryPool::instance().allocate(layout, indexType, packed.data(), vertexTotal, shortIndices.data(), indexTotal);
+        }
+        else
+            geometry = GeometryPool::instance().allocate(layout, indexType, packed.data(), vertexTotal, indices.data(), indexTotal);
+        VAO = geometry.vao;
     }
 };
 #endif
\ No newline at end of file
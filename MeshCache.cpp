@@ -0,0 +1,356 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const char cacheMagic[4] = { 'C', 'M', 'S', 'H' };
+
+	// every array in the file starts on this boundary so it can be read in place from the mapping
+	const size_t arrayAlignment = 16;
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t importFlags;
+		uint32_t vertexSize;
+		int64_t sourceTime;
+		uint64_t sourceSize;
+		uint32_t meshCount;
+		uint32_t materialCount;
+		uint32_t boneCount;
+		int32_t boneCounter;
+		uint32_t sourcePathLength;
+		uint64_t arenaBytes;  // what the meshes' arrays take in a GeometryArena, so load can size it once
+	};
+
+	size_t arenaBytesFor(size_t bytes)
+	{
+		return (bytes + GeometryArena::alignment - 1) & ~(GeometryArena::alignment - 1);
+	}
+
+	bool sourceStamp(const std::string& sourcePath, int64_t& time, uint64_t& size)
+	{
+		std::error_code ec;
+		auto writeTime = std::filesystem::last_write_time(sourcePath, ec);
+		if (ec)
+			return false;
+		auto fileSize = std::filesystem::file_size(sourcePath, ec);
+		if (ec)
+			return false;
+		time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		size = static_cast<uint64_t>(fileSize);
+		return true;
+	}
+
+	// bounds checked reader over the mapped file
+	class Reader
+	{
+	public:
+		Reader(const unsigned char* data, size_t size) : m_Data(data), m_Size(size) {}
+
+		const unsigned char* take(size_t bytes)
+		{
+			if (m_Failed || bytes > m_Size - m_Offset)
+			{
+				m_Failed = true;
+				return nullptr;
+			}
+			const unsigned char* p = m_Data + m_Offset;
+			m_Offset += bytes;
+			return p;
+		}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			const unsigned char* p = take(sizeof(T));
+			if (p)
+				std::memcpy(&value, p, sizeof(T));
+			return p != nullptr;
+		}
+
+		bool readString(std::string& value)
+		{
+			uint32_t length = 0;
+			if (!read(length))
+				return false;
+			const unsigned char* p = take(length);
+			if (p)
+				value.assign(reinterpret_cast<const char*>(p), length);
+			return p != nullptr;
+		}
+
+		void align()
+		{
+			size_t padding = (arrayAlignment - m_Offset % arrayAlignment) % arrayAlignment;
+			take(padding);
+		}
+
+		bool failed() const { return m_Failed; }
+		size_t remaining() const { return m_Size - m_Offset; }
+
+		// a count from the file is only trusted if that many items of at least itemBytes each still fit,
+		// so a corrupt count can't make the loader allocate more than the file could describe
+		bool fits(uint64_t count, size_t itemBytes)
+		{
+			if (m_Failed || count > remaining() / itemBytes)
+				m_Failed = true;
+			return !m_Failed;
+		}
+
+	private:
+		const unsigned char* m_Data;
+		size_t m_Size;
+		size_t m_Offset = 0;
+		bool m_Failed = false;
+	};
+
+	class Writer
+	{
+	public:
+		explicit Writer(std::ofstream& out) : m_Out(out) {}
+
+		void write(const void* data, size_t bytes)
+		{
+			m_Out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+			m_Offset += bytes;
+		}
+
+		template<typename T>
+		void write(const T& value) { write(&value, sizeof(T)); }
+
+		void writeString(const std::string& value)
+		{
+			write(static_cast<uint32_t>(value.size()));
+			write(value.data(), value.size());
+		}
+
+		void align()
+		{
+			static const char zeros[arrayAlignment] = {};
+			write(zeros, (arrayAlignment - m_Offset % arrayAlignment) % arrayAlignment);
+		}
+
+	private:
+		std::ofstream& m_Out;
+		size_t m_Offset = 0;
+	};
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath)
+{
+	return sourcePath + ".meshcache";
+}
+
+bool MeshCache::load(const std::string& sourcePath, unsigned int importFlags, ModelData& out)
+{
+	int64_t sourceTime;
+	uint64_t sourceSize;
+	if (!sourceStamp(sourcePath, sourceTime, sourceSize))
+		return false;
+
+	MappedFile file;
+	if (!file.open(cachePathFor(sourcePath)))
+		return false;
+
+	Reader reader(file.data(), file.size());
+	CacheHeader header;
+	if (!reader.read(header)
+		|| std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0
+		|| header.version != version
+		|| header.importFlags != importFlags
+		|| header.vertexSize != sizeof(Vertex)
+		|| header.sourceTime != sourceTime
+		|| header.sourceSize != sourceSize)
+		return false;
+
+	const unsigned char* storedPath = reader.take(header.sourcePathLength);
+	if (!storedPath || sourcePath.compare(0, std::string::npos, reinterpret_cast<const char*>(storedPath), header.sourcePathLength) != 0)
+		return false;
+
+	ModelData model;
+	std::map<std::string, BoneInfo> bones;
+	for (uint32_t i = 0; i < header.boneCount; i++)
+	{
+		std::string name;
+		BoneInfo info;
+		if (!reader.readString(name) || !reader.read(info.id) || !reader.read(info.offset))
+			return false;
+		bones[name] = info;
+	}
+	model.skeleton = std::make_shared<Skeleton>(std::move(bones), header.boneCounter);
+
+	// a material is at least its name's length, its constants and its texture count
+	if (!reader.fits(header.materialCount, sizeof(uint32_t) + sizeof(MaterialConstants) + sizeof(uint32_t)))
+		return false;
+	model.materials.resize(header.materialCount);
+	for (MaterialSource& material : model.materials)
+	{
+		uint32_t textureCount = 0;
+		if (!reader.readString(material.name) || !reader.read(material.constants) || !reader.read(textureCount)
+			|| !reader.fits(textureCount, 2 * sizeof(uint32_t)))
+			return false;
+		material.textures.resize(textureCount);
+		for (TextureSource& texture : material.textures)
+		{
+			if (!reader.readString(texture.type) || !reader.readString(texture.path))
+				return false;
+		}
+	}
+
+	// a mesh is at least its five counts, its arrays take no more in the arena than twice their
+	// size in the file (16 bit indices are widened) plus the padding of two arrays
+	if (!reader.fits(header.meshCount, 5 * sizeof(uint32_t))
+		|| header.arenaBytes > 2 * uint64_t(reader.remaining()) + uint64_t(header.meshCount) * 2 * GeometryArena::alignment)
+		return false;
+	model.arena.reserve(header.arenaBytes);
+	model.meshes.resize(header.meshCount);
+	for (MeshGeometry& mesh : model.meshes)
+	{
+		uint32_t vertexCount = 0, indexCount = 0;
+		if (!reader.read(vertexCount) || !reader.read(indexCount) || !reader.read(mesh.material) || !reader.read(mesh.layout.flags)
+			|| mesh.material >= model.materials.size())
+			return false;
+
+		uint32_t lodCount = 0;
+		if (!reader.read(lodCount) || !reader.fits(lodCount, sizeof(MeshLod)))
+			return false;
+		mesh.lods.resize(lodCount);
+		for (MeshLod& lod : mesh.lods)
+		{
+			// every level is a range of the mesh's indices
+			if (!reader.read(lod) || uint64_t(lod.indexOffset) + lod.indexCount > indexCount)
+				return false;
+		}
+
+		reader.align();
+		const unsigned char* vertices = reader.take(size_t(vertexCount) * sizeof(Vertex));
+		reader.align();
+		const bool shortIndices = vertexCount <= maxShortIndexVertices;
+		const unsigned char* indices = reader.take(size_t(indexCount) * (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t)));
+		if (reader.failed())
+			return false;
+
+		// an index past the vertices would make the GPU read outside the mesh
+		const bool indicesValid = shortIndices
+			? std::all_of(reinterpret_cast<const uint16_t*>(indices), reinterpret_cast<const uint16_t*>(indices) + indexCount, [&](uint16_t index) { return index < vertexCount; })
+			: std::all_of(reinterpret_cast<const uint32_t*>(indices), reinterpret_cast<const uint32_t*>(indices) + indexCount, [&](uint32_t index) { return index < vertexCount; });
+		if (!indicesValid)
+			return false;
+
+		// arrays are aligned inside a page aligned mapping, a single copy out of the page cache into the arena
+		mesh.vertices = model.arena.copy(reinterpret_cast<const Vertex*>(vertices), vertexCount);
+		if (shortIndices)
+		{
+			mesh.indices = model.arena.allocate<unsigned int>(indexCount);
+			std::copy(reinterpret_cast<const uint16_t*>(indices), reinterpret_cast<const uint16_t*>(indices) + indexCount, mesh.indices.begin());
+		}
+		else
+			mesh.indices = model.arena.copy(reinterpret_cast<const uint32_t*>(indices), indexCount);
+	}
+
+	out = std::move(model);
+	return true;
+}
+
+bool MeshCache::save(const std::string& sourcePath, unsigned int importFlags, const ModelData& model)
+{
+	CacheHeader header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = version;
+	header.importFlags = importFlags;
+	header.vertexSize = sizeof(Vertex);
+	if (!sourceStamp(sourcePath, header.sourceTime, header.sourceSize))
+		return false;
+	header.meshCount = static_cast<uint32_t>(model.meshes.size());
+	header.materialCount = static_cast<uint32_t>(model.materials.size());
+	header.boneCount = static_cast<uint32_t>(model.skeleton->bones().size());
+	header.boneCounter = model.skeleton->boneCount();
+	header.sourcePathLength = static_cast<uint32_t>(sourcePath.size());
+	header.arenaBytes = 0;
+	for (const MeshGeometry& mesh : model.meshes)
+		header.arenaBytes += arenaBytesFor(mesh.vertices.size() * sizeof(Vertex)) + arenaBytesFor(mesh.indices.size() * sizeof(unsigned int));
+
+	// write to a temporary file first so a crash never leaves a torn cache behind
+	const std::string cachePath = cachePathFor(sourcePath);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR::MESHCACHE:: could not write " << tempPath << std::endl;
+			return false;
+		}
+
+		Writer writer(out);
+		writer.write(header);
+		writer.write(sourcePath.data(), sourcePath.size());
+
+		for (const auto& bone : model.skeleton->bones())
+		{
+			writer.writeString(bone.first);
+			writer.write(bone.second.id);
+			writer.write(bone.second.offset);
+		}
+
+		for (const MaterialSource& material : model.materials)
+		{
+			writer.writeString(material.name);
+			writer.write(material.constants);
+			writer.write(static_cast<uint32_t>(material.textures.size()));
+			for (const TextureSource& texture : material.textures)
+			{
+				writer.writeString(texture.type);
+				writer.writeString(texture.path);
+			}
+		}
+
+		for (const MeshGeometry& mesh : model.meshes)
+		{
+			writer.write(static_cast<uint32_t>(mesh.vertices.size()));
+			writer.write(static_cast<uint32_t>(mesh.indices.size()));
+			writer.write(mesh.material);
+			writer.write(mesh.layout.flags);
+
+			writer.write(static_cast<uint32_t>(mesh.lods.size()));
+			for (const MeshLod& lod : mesh.lods)
+				writer.write(lod);
+
+			writer.align();
+			writer.write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+			writer.align();
+			if (mesh.vertices.size() <= maxShortIndexVertices)
+			{
+				// stored at the width they are drawn with
+				std::vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.end());
+				writer.write(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+			}
+			else
+				writer.write(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		}
+
+		if (!out)
+		{
+			std::cout << "ERROR::MESHCACHE:: failed while writing " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::cout << "ERROR::MESHCACHE:: could not replace " << cachePath << ": " << ec.message() << std::endl;
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
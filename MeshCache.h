@@ -0,0 +1,41 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "Skeleton.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// everything Model keeps from an import, independent of the file format it came from.
+// The meshes' arrays live in the arena, which the Model takes over.
+struct ModelData
+{
+	GeometryArena arena;
+	std::vector<MeshGeometry> meshes;
+	std::vector<MaterialSource> materials;  // MeshGeometry::material indexes these
+	std::shared_ptr<Skeleton> skeleton = std::make_shared<Skeleton>();
+};
+
+// Binary cache of imported models. After the first Assimp import the final vertex/index
+// arrays are written next to the source file ("<path>.meshcache"), and later runs map that
+// file and hand the arrays to Mesh::setupMesh without touching Assimp.
+// A cache file is only used if the format version, sizeof(Vertex), the import flags and the
+// source file's path, size and modification time all match, otherwise it is rebuilt.
+class MeshCache
+{
+public:
+	// bump whenever the layout of the file or of the cooked data changes
+	static const unsigned int version = 9;
+
+	static std::string cachePathFor(const std::string& sourcePath);
+
+	// returns false on a miss (no file, stale key or damaged file), out is left untouched
+	static bool load(const std::string& sourcePath, unsigned int importFlags, ModelData& out);
+	static bool save(const std::string& sourcePath, unsigned int importFlags, const ModelData& model);
+};
+
+#endif
@@ -0,0 +1,386 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+	struct VertexHash
+	{
+		size_t operator()(const Vertex& vertex) const
+		{
+			// FNV-1a over the raw bytes, Vertex has no padding
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (size_t i = 0; i < sizeof(Vertex); i++)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const Vertex& a, const Vertex& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+
+	// Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	const float cacheDecayPower = 1.5f;
+	const float lastTriangleScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	float vertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the three vertices of the last triangle get a fixed score so its neighbours don't win just by sharing one
+			if (cachePosition < 3)
+				score = lastTriangleScore;
+			else
+			{
+				const float scaler = 1.0f / (MeshOptimizer::optimizeCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+			}
+		}
+		// prefer vertices with few triangles left so they are finished off and leave the cache
+		score += valenceBoostScale * std::pow(float(remainingTriangles), -valenceBoostPower);
+		return score;
+	}
+}
+
+MeshOptimizer::CacheStats& MeshOptimizer::CacheStats::operator+=(const CacheStats& other)
+{
+	triangles += other.triangles;
+	vertices += other.vertices;
+	misses += other.misses;
+	return *this;
+}
+
+void MeshOptimizer::optimize(MeshData& mesh)
+{
+	if (mesh.indices.empty())
+		return;
+
+	weld(mesh.vertices, mesh.indices);
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeOverdraw(mesh.indices, mesh.vertices);
+	optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+size_t MeshOptimizer::weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+	unique.reserve(vertices.size());
+
+	std::vector<unsigned int> remap(vertices.size());
+	std::vector<Vertex> welded;
+	welded.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		auto inserted = unique.emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+		if (inserted.second)
+			welded.push_back(vertices[i]);
+		remap[i] = inserted.first->second;
+	}
+
+	for (unsigned int& index : indices)
+		index = remap[index];
+	vertices.swap(welded);
+	return vertices.size();
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles using each vertex, the first live[v] entries of a vertex's range are not emitted yet
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (unsigned int index : indices)
+		live[index]++;
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, live[v]);
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	std::vector<unsigned int> cache, nextCache;
+	cache.reserve(optimizeCacheSize + 3);
+	nextCache.reserve(optimizeCacheSize + 3);
+
+	size_t cursor = 0;
+	long best = -1;
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (best < 0)
+		{
+			// dead end, nothing in the cache has triangles left: continue with the next unemitted one
+			while (emitted[cursor])
+				cursor++;
+			best = static_cast<long>(cursor);
+		}
+
+		const unsigned int* triangle = &indices[best * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		// remove the triangle from its vertices' live lists
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* begin = &adjacency[offsets[v]];
+			unsigned int* end = begin + live[v];
+			unsigned int* it = std::find(begin, end, static_cast<unsigned int>(best));
+			std::swap(*it, *(end - 1));
+			live[v]--;
+		}
+
+		// move the triangle's vertices to the front of the LRU cache
+		nextCache.assign(triangle, triangle + 3);
+		for (unsigned int v : cache)
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		cache.swap(nextCache);
+
+		// rescore everything that was in the cache, including what just fell out of it
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			cachePosition[v] = i < optimizeCacheSize ? static_cast<int>(i) : -1;
+			score[v] = vertexScore(cachePosition[v], live[v]);
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			for (unsigned int j = 0; j < live[v]; j++)
+			{
+				unsigned int t = adjacency[offsets[v] + j];
+				float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				if (s > bestScore)
+				{
+					bestScore = s;
+					best = t;
+				}
+			}
+		}
+
+		if (cache.size() > optimizeCacheSize)
+			cache.resize(optimizeCacheSize);
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+		return;
+
+	const double meshAcmr = analyze(indices, vertices.size()).acmr();
+
+	// Split the cache ordered triangles into clusters. A new cluster starts where the cache is
+	// cold anyway (a triangle missing all three vertices) or where the current cluster on its own
+	// already transforms no more than threshold times the mesh's average, so drawing the clusters
+	// in any order keeps the ACMR within that bound.
+	std::vector<size_t> clusterStarts;
+	{
+		std::vector<unsigned int> timestamps(vertices.size(), 0);
+		unsigned int time = analyzeCacheSize + 1;
+		size_t clusterStart = 0, clusterMisses = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t * 3 + k];
+				if (time - timestamps[v] > analyzeCacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+
+			if (t == clusterStart || misses == 3)
+			{
+				clusterStarts.push_back(t);
+				clusterStart = t;
+				clusterMisses = 0;
+			}
+			clusterMisses += misses;
+
+			const size_t clusterTriangles = t - clusterStart + 1;
+			if (clusterTriangles >= analyzeCacheSize && double(clusterMisses) / clusterTriangles <= meshAcmr * threshold)
+			{
+				// restart with a cold cache, the next cluster may be drawn after anything
+				clusterStart = t + 1;
+				time += analyzeCacheSize + 1;
+			}
+		}
+	}
+
+	glm::vec3 meshCentroid(0.0f);
+	for (const Vertex& vertex : vertices)
+		meshCentroid += vertex.Position;
+	meshCentroid /= float(vertices.size());
+
+	// clusters facing away from the mesh centre are likely in front of the rest, draw them first
+	const size_t clusterCount = clusterStarts.size();
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const size_t begin = clusterStarts[c];
+		const size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = begin; t < end; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].Position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(cross);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		float normalLength = glm::length(normal);
+		if (normalLength > 0.0f)
+			normal /= normalLength;
+		sortKey[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t c : order)
+	{
+		const size_t begin = clusterStarts[c];
+		const size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+	}
+	indices.swap(result);
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<unsigned int>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+	return vertices.size();
+}
+
+std::vector<MeshData> MeshOptimizer::splitForShortIndices(MeshData& mesh, size_t maxVertices)
+{
+	std::vector<MeshData> parts;
+	if (mesh.vertices.size() <= maxVertices)
+	{
+		parts.push_back(std::move(mesh));
+		return parts;
+	}
+
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+	std::vector<unsigned int> touched;
+	MeshData part;
+	for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+	{
+		size_t added = 0;
+		for (int k = 0; k < 3; k++)
+			added += remap[mesh.indices[t + k]] == unused;
+		if (part.vertices.size() + added > maxVertices)
+		{
+			part.material = mesh.material;
+			parts.push_back(std::move(part));
+			part = MeshData();
+			for (unsigned int vertex : touched)
+				remap[vertex] = unused;
+			touched.clear();
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int vertex = mesh.indices[t + k];
+			if (remap[vertex] == unused)
+			{
+				remap[vertex] = static_cast<unsigned int>(part.vertices.size());
+				part.vertices.push_back(mesh.vertices[vertex]);
+				touched.push_back(vertex);
+			}
+			part.indices.push_back(remap[vertex]);
+		}
+	}
+	if (!part.indices.empty())
+	{
+		part.material = mesh.material;
+		parts.push_back(std::move(part));
+	}
+	return parts;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyze(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats;
+	stats.triangles = indices.size() / 3;
+	stats.vertices = vertexCount;
+
+	// FIFO: a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	for (unsigned int index : indices)
+	{
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			stats.misses++;
+		}
+	}
+	return stats;
+}
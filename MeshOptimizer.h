@@ -0,0 +1,57 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+// Import time optimization of a mesh's vertex and index data for the GPU, run in the CPU phase
+// of Model::importModel. The steps can be used on their own, optimize() runs all of them in order:
+// weld identical vertices, reorder triangles for the post-transform cache (Forsyth), group the
+// result into clusters drawn front-most first to cut overdraw, and renumber the vertices in the
+// order the indices first use them so vertex fetch walks the buffer linearly.
+class MeshOptimizer
+{
+public:
+	// post-transform cache behaviour of an index buffer, simulated as a FIFO
+	struct CacheStats
+	{
+		size_t triangles = 0;
+		size_t vertices = 0;
+		size_t misses = 0;
+
+		// average cache miss ratio: transformed vertices per triangle, 0.5 is ideal for large grids, 3 is the worst
+		double acmr() const { return triangles ? double(misses) / triangles : 0.0; }
+		// average transform to vertex ratio: 1 means every vertex is transformed exactly once
+		double atvr() const { return vertices ? double(misses) / vertices : 0.0; }
+
+		CacheStats& operator+=(const CacheStats& other);
+	};
+
+	// the cache size the reordering optimizes for and the one statistics are reported with
+	static const unsigned int optimizeCacheSize = 32;
+	static const unsigned int analyzeCacheSize = 16;
+
+	static void optimize(MeshData& mesh);
+
+	// merges bitwise identical vertices, returns the new vertex count
+	static size_t weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	static void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// threshold is how much worse than the input the ACMR may get in exchange for less overdraw
+	static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+	// drops unreferenced vertices, returns the new vertex count
+	static size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	// cuts a mesh into consecutive runs of triangles that use at most maxVertices vertices each, so
+	// every part can be drawn with 16 bit indices. Keeps the triangle order, every part's vertices
+	// are numbered in first use order. A mesh that already fits comes back as the only part.
+	static std::vector<MeshData> splitForShortIndices(MeshData& mesh, size_t maxVertices = maxShortIndexVertices);
+
+	static CacheStats analyze(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = analyzeCacheSize);
+};
+
+#endif
@@ -0,0 +1,492 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	// plane distance quadric, the symmetric 4x4 matrix is kept as its 10 distinct entries
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+		double weight = 0;
+
+		void addPlane(const glm::vec3& normal, float distance, double w)
+		{
+			const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+			weight += q.weight;
+			return *this;
+		}
+
+		// weighted mean of the squared distances to the planes
+		double error(const glm::vec3& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+			return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	// border edges weigh more than faces so the silhouette of open meshes survives
+	const double borderWeight = 10.0;
+
+	struct PositionKey
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	// gives bitwise equal positions the same id, wedges of a position differ only in their attributes
+	std::vector<unsigned int> positionIds(const std::vector<Vertex>& vertices, size_t& positionCount)
+	{
+		std::unordered_map<glm::vec3, unsigned int, PositionKey> ids;
+		ids.reserve(vertices.size());
+		std::vector<unsigned int> result(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+			result[i] = ids.emplace(vertices[i].Position, static_cast<unsigned int>(ids.size())).first->second;
+		positionCount = ids.size();
+		return result;
+	}
+
+	// an edge between two positions and the wedges its first two triangles use at either end
+	struct Edge
+	{
+		unsigned int count = 0;
+		unsigned int low[2] = { 0, 0 };   // wedge at the smaller position id
+		unsigned int high[2] = { 0, 0 };  // wedge at the larger one
+	};
+
+	uint64_t edgeKey(unsigned int a, unsigned int b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	enum class Kind { Manifold, Border, Seam, Locked };
+
+	glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+}
+
+void MeshSimplifier::buildLods(MeshData& mesh)
+{
+	const size_t baseCount = mesh.indices.size();
+	mesh.lods.assign(1, MeshLod{ 0, static_cast<unsigned int>(baseCount), 0.0f });
+	if (baseCount / 3 < minTriangles)
+		return;
+
+	std::vector<unsigned int> previous = mesh.indices;
+	float previousError = 0.0f;
+	for (unsigned int level = 1; level < maxLods; level++)
+	{
+		const size_t target = (baseCount >> level) / 3 * 3;
+
+		float error = 0.0f;
+		std::vector<unsigned int> lod = simplify(mesh.vertices, previous, target, FLT_MAX, error);
+		if (lod.size() > target + target / 2)
+		{
+			// held back by seams, cluster what is left
+			float sloppyError = 0.0f;
+			lod = simplifySloppy(mesh.vertices, lod, target, sloppyError);
+			error = std::max(error, sloppyError);
+		}
+
+		// not worth a level of its own
+		if (lod.empty() || lod.size() * 10 > previous.size() * 9)
+			break;
+
+		// errors are measured against the previous level, they add up along the chain
+		error += previousError;
+		MeshOptimizer::optimizeVertexCache(lod, mesh.vertices.size());
+		mesh.lods.push_back({ static_cast<unsigned int>(mesh.indices.size()), static_cast<unsigned int>(lod.size()), error });
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+
+		previous.swap(lod);
+		previousError = error;
+	}
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float targetError, float& resultError)
+{
+	resultError = 0.0f;
+	size_t positionCount = 0;
+	const std::vector<unsigned int> positionOf = positionIds(vertices, positionCount);
+	auto position = [&](unsigned int wedge) -> const glm::vec3& { return vertices[wedge].Position; };
+
+	std::vector<unsigned int> current = indices;
+	std::vector<Quadric> quadrics(positionCount);
+	{
+		std::unordered_map<uint64_t, unsigned int> edgeCount;
+		for (size_t t = 0; t < current.size(); t += 3)
+		{
+			const glm::vec3& p0 = position(current[t]);
+			glm::vec3 normal = triangleNormal(p0, position(current[t + 1]), position(current[t + 2]));
+			float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+			normal /= length;
+			const float distance = -glm::dot(normal, p0);
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[positionOf[current[t + k]]].addPlane(normal, distance, length * 0.5);
+				edgeCount[edgeKey(positionOf[current[t + k]], positionOf[current[t + (k + 1) % 3]])]++;
+			}
+		}
+
+		// constrain border vertices to the plane through the edge, perpendicular to the face
+		for (size_t t = 0; t < current.size(); t += 3)
+		{
+			const glm::vec3& p0 = position(current[t]);
+			glm::vec3 faceNormal = triangleNormal(p0, position(current[t + 1]), position(current[t + 2]));
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int a = current[t + k], b = current[t + (k + 1) % 3];
+				if (edgeCount[edgeKey(positionOf[a], positionOf[b])] != 1)
+					continue;
+				glm::vec3 edge = position(b) - position(a);
+				glm::vec3 normal = glm::cross(edge, faceNormal);
+				float length = glm::length(normal);
+				if (length == 0.0f)
+					continue;
+				normal /= length;
+				const float distance = -glm::dot(normal, position(a));
+				const double weight = borderWeight * glm::length(edge) * glm::length(edge);
+				quadrics[positionOf[a]].addPlane(normal, distance, weight);
+				quadrics[positionOf[b]].addPlane(normal, distance, weight);
+			}
+		}
+	}
+
+	const double maxCost = double(targetError) * targetError;
+	std::vector<unsigned int> wedgeRemap(vertices.size());
+	std::vector<Kind> kinds(positionCount);
+	std::vector<unsigned int> wedgeA(positionCount), wedgeB(positionCount), wedgeCount(positionCount);
+	std::vector<unsigned int> borderEdges(positionCount), seamEdges(positionCount);
+	std::vector<bool> touched(positionCount);
+	// how far the surface around every position has moved from the input so far, the quadric
+	// cost is only a mean over its planes
+	std::vector<float> moved(positionCount, 0.0f);
+	std::vector<unsigned int> incidentOffsets(positionCount + 1), incident;
+
+	struct Collapse
+	{
+		unsigned int from, to;  // position ids
+		uint64_t edge;
+		double cost;
+	};
+	std::vector<Collapse> collapses;
+
+	while (current.size() > targetIndexCount)
+	{
+		const size_t triangleCount = current.size() / 3;
+
+		// edge table and the kind of every position for this pass
+		std::unordered_map<uint64_t, Edge> edges;
+		edges.reserve(current.size());
+		std::fill(wedgeCount.begin(), wedgeCount.end(), 0);
+		std::fill(borderEdges.begin(), borderEdges.end(), 0);
+		std::fill(seamEdges.begin(), seamEdges.end(), 0);
+		std::fill(kinds.begin(), kinds.end(), Kind::Manifold);
+		for (size_t t = 0; t < current.size(); t += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int wa = current[t + k], wb = current[t + (k + 1) % 3];
+				unsigned int pa = positionOf[wa], pb = positionOf[wb];
+				Edge& edge = edges[edgeKey(pa, pb)];
+				if (edge.count < 2)
+				{
+					edge.low[edge.count] = pa < pb ? wa : wb;
+					edge.high[edge.count] = pa < pb ? wb : wa;
+				}
+				edge.count++;
+
+				// distinct wedges per position, two are enough to tell the kinds apart
+				if (wedgeCount[pa] == 0 || (wedgeCount[pa] == 1 && wedgeA[pa] != wa))
+				{
+					(wedgeCount[pa] == 0 ? wedgeA[pa] : wedgeB[pa]) = wa;
+					wedgeCount[pa]++;
+				}
+				else if (wedgeCount[pa] == 2 && wedgeA[pa] != wa && wedgeB[pa] != wa)
+					wedgeCount[pa] = 3;
+			}
+		}
+		for (const auto& entry : edges)
+		{
+			unsigned int low = static_cast<unsigned int>(entry.first >> 32), high = static_cast<unsigned int>(entry.first);
+			const Edge& edge = entry.second;
+			if (edge.count == 1)
+			{
+				borderEdges[low]++;
+				borderEdges[high]++;
+			}
+			else if (edge.count > 2)
+			{
+				kinds[low] = Kind::Locked;
+				kinds[high] = Kind::Locked;
+			}
+			else if (edge.low[0] != edge.low[1] || edge.high[0] != edge.high[1])
+			{
+				seamEdges[low]++;
+				seamEdges[high]++;
+			}
+		}
+		for (size_t p = 0; p < positionCount; p++)
+		{
+			if (kinds[p] == Kind::Locked)
+				continue;
+			if (wedgeCount[p] == 1 && borderEdges[p] == 0 && seamEdges[p] == 0)
+				kinds[p] = Kind::Manifold;
+			else if (wedgeCount[p] == 1 && borderEdges[p] == 2 && seamEdges[p] == 0)
+				kinds[p] = Kind::Border;
+			else if (wedgeCount[p] == 2 && seamEdges[p] == 2 && borderEdges[p] == 0)
+				kinds[p] = Kind::Seam;
+			else
+				kinds[p] = Kind::Locked;
+		}
+
+		// which collapse of every edge is allowed and cheapest
+		collapses.clear();
+		for (const auto& entry : edges)
+		{
+			unsigned int low = static_cast<unsigned int>(entry.first >> 32), high = static_cast<unsigned int>(entry.first);
+			const Edge& edge = entry.second;
+			const bool border = edge.count == 1;
+			const bool seam = edge.count == 2 && edge.low[0] != edge.low[1] && edge.high[0] != edge.high[1];
+
+			Collapse best{ 0, 0, entry.first, DBL_MAX };
+			for (int direction = 0; direction < 2; direction++)
+			{
+				unsigned int from = direction == 0 ? low : high, to = direction == 0 ? high : low;
+				bool allowed = (kinds[from] == Kind::Manifold && edge.count == 2 && !seam)
+					|| (kinds[from] == Kind::Border && border)
+					|| (kinds[from] == Kind::Seam && seam);
+				if (!allowed)
+					continue;
+				double cost = quadrics[from].error(position(direction == 0 ? edge.high[0] : edge.low[0]));
+				if (cost < best.cost)
+					best = { from, to, entry.first, cost };
+			}
+			if (best.cost <= maxCost)
+				collapses.push_back(best);
+		}
+		if (collapses.empty())
+			break;
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// triangles around every position, for the flip test and to lock the one-ring
+		std::fill(incidentOffsets.begin(), incidentOffsets.end(), 0);
+		for (unsigned int wedge : current)
+			incidentOffsets[positionOf[wedge] + 1]++;
+		for (size_t p = 0; p < positionCount; p++)
+			incidentOffsets[p + 1] += incidentOffsets[p];
+		incident.resize(current.size());
+		{
+			std::vector<unsigned int> fill(incidentOffsets.begin(), incidentOffsets.end() - 1);
+			for (size_t i = 0; i < current.size(); i++)
+				incident[fill[positionOf[current[i]]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		for (size_t w = 0; w < wedgeRemap.size(); w++)
+			wedgeRemap[w] = static_cast<unsigned int>(w);
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t removed = 0, applied = 0;
+		const size_t toRemove = triangleCount - targetIndexCount / 3;
+		for (const Collapse& collapse : collapses)
+		{
+			if (removed >= toRemove)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			const Edge& edge = edges[collapse.edge];
+			const bool fromLow = collapse.from < collapse.to;
+			const glm::vec3& target = position(fromLow ? edge.high[0] : edge.low[0]);
+
+			// moving the vertex must not fold any of its remaining triangles over. The farthest the
+			// vertex ends up from the plane of one of them is how far the surface moved
+			bool flips = false;
+			float planeDistance = 0.0f;
+			for (unsigned int i = incidentOffsets[collapse.from]; i < incidentOffsets[collapse.from + 1] && !flips; i++)
+			{
+				const unsigned int* triangle = &current[incident[i] * 3];
+				glm::vec3 before[3], after[3];
+				bool containsTarget = false;
+				for (int k = 0; k < 3; k++)
+				{
+					before[k] = after[k] = position(triangle[k]);
+					if (positionOf[triangle[k]] == collapse.to)
+						containsTarget = true;
+					if (positionOf[triangle[k]] == collapse.from)
+						after[k] = target;
+				}
+				if (containsTarget)
+					continue;
+				glm::vec3 n0 = triangleNormal(before[0], before[1], before[2]);
+				glm::vec3 n1 = triangleNormal(after[0], after[1], after[2]);
+				flips = glm::dot(n0, n1) < 0.25f * glm::length(n0) * glm::length(n1);
+				const float area = glm::length(n0);
+				if (area > 0.0f)
+					planeDistance = std::max(planeDistance, std::fabs(glm::dot(n0, target - before[0])) / area);
+			}
+			if (flips)
+				continue;
+
+			// every wedge of the vertex takes the attributes of its counterpart across the edge
+			for (int side = 0; side < (edge.count == 2 ? 2 : 1); side++)
+			{
+				unsigned int fromWedge = fromLow ? edge.low[side] : edge.high[side];
+				unsigned int toWedge = fromLow ? edge.high[side] : edge.low[side];
+				wedgeRemap[fromWedge] = toWedge;
+			}
+			quadrics[collapse.to] += quadrics[collapse.from];
+			const float distance = moved[collapse.from] + planeDistance;
+			moved[collapse.to] = std::max(moved[collapse.to], distance);
+			resultError = std::max(resultError, distance);
+
+			for (unsigned int i = incidentOffsets[collapse.from]; i < incidentOffsets[collapse.from + 1]; i++)
+				for (int k = 0; k < 3; k++)
+					touched[positionOf[current[incident[i] * 3 + k]]] = true;
+			touched[collapse.to] = true;
+
+			removed += edge.count;
+			applied++;
+		}
+		if (applied == 0)
+			break;
+
+		// apply the pass and drop the triangles that collapsed to a line
+		size_t write = 0;
+		for (size_t t = 0; t < current.size(); t += 3)
+		{
+			unsigned int a = wedgeRemap[current[t]], b = wedgeRemap[current[t + 1]], c = wedgeRemap[current[t + 2]];
+			if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c])
+				continue;
+			current[write++] = a;
+			current[write++] = b;
+			current[write++] = c;
+		}
+		current.resize(write);
+	}
+
+	return current;
+}
+
+std::vector<unsigned int> MeshSimplifier::simplifySloppy(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float& resultError)
+{
+	resultError = 0.0f;
+	if (indices.empty())
+		return indices;
+
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (unsigned int index : indices)
+	{
+		minimum = glm::min(minimum, vertices[index].Position);
+		maximum = glm::max(maximum, vertices[index].Position);
+	}
+	const glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(1e-6f));
+
+	// per vertex quadrics pick the cell representative that best keeps the surrounding faces
+	std::vector<Quadric> quadrics(vertices.size());
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[t]].Position;
+		glm::vec3 normal = triangleNormal(p0, vertices[indices[t + 1]].Position, vertices[indices[t + 2]].Position);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+		normal /= length;
+		for (int k = 0; k < 3; k++)
+			quadrics[indices[t + k]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+	}
+
+	std::vector<unsigned int> result, cells(vertices.size());
+	auto cluster = [&](unsigned int grid, bool build) -> size_t
+	{
+		std::unordered_map<uint64_t, unsigned int> cellIds;
+		for (unsigned int index : indices)
+		{
+			glm::vec3 cell = (vertices[index].Position - minimum) / extent * float(grid);
+			uint64_t x = std::min(unsigned(cell.x), grid - 1), y = std::min(unsigned(cell.y), grid - 1), z = std::min(unsigned(cell.z), grid - 1);
+			cells[index] = cellIds.emplace((x << 40) | (y << 20) | z, static_cast<unsigned int>(cellIds.size())).first->second;
+		}
+
+		size_t count = 0;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			unsigned int a = cells[indices[t]], b = cells[indices[t + 1]], c = cells[indices[t + 2]];
+			if (a != b && b != c && a != c)
+				count += 3;
+		}
+		if (!build)
+			return count;
+
+		std::vector<Quadric> cellQuadrics(cellIds.size());
+		for (unsigned int index : indices)
+			cellQuadrics[cells[index]] += quadrics[index];
+		std::vector<unsigned int> representative(cellIds.size(), ~0u);
+		std::vector<double> representativeError(cellIds.size(), DBL_MAX);
+		for (unsigned int index : indices)
+		{
+			unsigned int cell = cells[index];
+			double error = cellQuadrics[cell].error(vertices[index].Position);
+			if (error < representativeError[cell])
+			{
+				representativeError[cell] = error;
+				representative[cell] = index;
+			}
+		}
+
+		result.clear();
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			unsigned int a = cells[indices[t]], b = cells[indices[t + 1]], c = cells[indices[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			result.push_back(representative[a]);
+			result.push_back(representative[b]);
+			result.push_back(representative[c]);
+		}
+		for (unsigned int index : indices)
+			resultError = std::max(resultError, glm::length(vertices[index].Position - vertices[representative[cells[index]]].Position));
+		return count;
+	};
+
+	// the finest grid that still meets the target
+	unsigned int low = 1, high = 1024;
+	while (low < high)
+	{
+		unsigned int middle = (low + high + 1) / 2;
+		if (cluster(middle, false) <= targetIndexCount)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+	cluster(low, true);
+	return result;
+}
@@ -0,0 +1,34 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "Mesh.h"
+
+#include <vector>
+
+// Builds the level of detail chain of a mesh at import time. Every level is only an index list
+// into the mesh's full vertex buffer, all levels live in the same element buffer one after the
+// other and Mesh::Draw picks the range. Errors are in model space units, the largest distance a
+// surface point moved, so the renderer can compare their projected size against a pixel budget.
+class MeshSimplifier
+{
+public:
+	static const unsigned int maxLods = 4;
+	// meshes smaller than this are drawn at full detail at any distance
+	static const unsigned int minTriangles = 64;
+
+	// appends levels at 1/2, 1/4 and 1/8 of the triangles until they stop getting smaller
+	static void buildLods(MeshData& mesh);
+
+	// Quadric error metric edge collapse (Garland & Heckbert), every collapse moves a vertex onto
+	// a neighbour, so no new vertices are created. Open borders only collapse along themselves and
+	// UV/normal seams only along the seam, vertices where more attributes meet stay where they are.
+	static std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float targetError, float& resultError);
+
+	// Vertex clustering on a grid: much coarser, but not held back by seams. Used when simplify()
+	// can't get near the target because most of the vertices are on attribute seams.
+	static std::vector<unsigned int> simplifySloppy(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float& resultError);
+};
+
+#endif
@@ -10,7 +10,15 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "Material.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Animation.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+#include "TextureCache.h"
 #include "Shader.h"
 #include "Camera.h"
 
@@ -23,6 +31,7 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "glm_helper.h"
 #include "AnimData.h"
@@ -34,78 +43,301 @@
 
 using namespace std;
 
+// what a Model keeps in system memory once its meshes are on the GPU
+enum class GeometryResidency
+{
+	GpuOnly,           // only the bounds, the vertex and index arrays are freed after upload
+	GpuWithCollision,  // the bounds and a position only collision mesh built from the coarsest LOD
+	KeepCpuCopy,       // the full arrays stay, for tools that read the geometry back
+};
+
+// triangle soup for collision queries, welded by position
+struct CollisionMesh
+{
+	vector<glm::vec3>    positions;
+	vector<unsigned int> indices;
+
+	size_t bytes() const { return positions.capacity() * sizeof(glm::vec3) + indices.capacity() * sizeof(unsigned int); }
+};
+
 class Model
 {
 public:
 	// model data 
-	vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	vector<Texture> textures_loaded;	// one entry per reference this model holds in the TextureCache, released with the model
 	vector<Mesh>    meshes;
+	vector<Material> materials;         // Mesh::material indexes these
 	string directory;
 	bool gammaCorrection;
+	GeometryResidency residency;
 
+	// model space bounds of every vertex, computed before the CPU copies are released
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	// only filled with GeometryResidency::GpuWithCollision
+	CollisionMesh collision;
 
+	struct GeometryMemory
+	{
+		size_t cpuBytes = 0;  // the geometry arena and the collision mesh
+		size_t gpuBytes = 0;  // vertex and element buffers
+	};
 
-	// constructor, expects a filepath to a 3D model.
-	Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
+	// constructor, expects a filepath to a 3D model. Runs both phases of the load on the calling thread.
+	Model(string const& path, bool gamma = false, GeometryResidency residency = GeometryResidency::GpuOnly) : gammaCorrection(gamma), residency(residency)
 	{
-		loadModel(path);
+		ModelData data;
+		importModel(path, data);
+		createMeshes(path, data);
+	}
+
+	// GL phase only, for data importModel() produced on another thread
+	Model(string const& path, ModelData&& data, bool gamma = false, GeometryResidency residency = GeometryResidency::GpuOnly) : gammaCorrection(gamma), residency(residency)
+	{
+		createMeshes(path, data);
+	}
+
+	// the model owns references in the TextureCache, ranges of the GeometryPool and MaterialTable slots, so it can't be copied
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	~Model()
+	{
+		for (const Texture& texture : textures_loaded)
+			TextureCache::instance().release(texture.id);
+		for (Mesh& mesh : meshes)
+			mesh.releaseGpuData();
+		for (Material& material : materials)
+			material.release();
 	}
 
 	// draws the model, and thus all its meshes
-	void Draw(Shader& shader)
+	void Draw(Shader& shader, unsigned int lod = 0)
 	{
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
+		{
+			materials[meshes[i].material].bind(shader);
+			meshes[i].Draw(lod);
+		}
 	}
 
-	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
-	int& GetBoneCount() { return m_BoneCounter; }
+	GeometryMemory geometryMemory() const
+	{
+		GeometryMemory memory;
+		for (const Mesh& mesh : meshes)
+			memory.gpuBytes += mesh.gpuBytes();
+		memory.cpuBytes = geometry.reservedBytes() + collision.bytes();
+		return memory;
+	}
 
+	unsigned int lodCount() const { return static_cast<unsigned int>(lodErrors.size()); }
+	// largest distance any surface point moved at this level, model units
+	float lodError(unsigned int lod) const { return lodErrors.empty() ? 0.0f : lodErrors[std::min<size_t>(lod, lodErrors.size() - 1)]; }
 
-private:
+	// import flags are part of the mesh cache key, changing them invalidates cached files
+	static const unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
 
-	std::map<string, BoneInfo> m_BoneInfoMap;
-	int m_BoneCounter = 0;
+	// shared with every Animation played on the model
+	const std::shared_ptr<Skeleton>& skeleton() const { return m_Skeleton; }
 
-	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-	void loadModel(string const& path)
+	// CPU phase of the load: reads a model with supported ASSIMP extensions from file into out.
+	// A warm start skips ASSIMP entirely and reads the cooked meshes from the mesh cache. Makes no
+	// GL calls and touches no shared state, so several models can be imported at once.
+	// With clips, every animation of the file is read from the same parse onto out.skeleton; the
+	// file is then always parsed, but the meshes still come from the cache when it is warm.
+	static bool importModel(string const& path, ModelData& out, vector<std::unique_ptr<Animation>>* clips = nullptr)
 	{
+		const bool cached = MeshCache::load(path, importFlags, out);
+		if (cached && !clips)
+			return true;
+
+		// OBJ files have a native reader and no clips, ASSIMP stays the fallback for anything it can't read
+		ObjLoader obj;
+		if (!cached && ObjLoader::handles(path) && obj.open(path))
+		{
+			processObj(obj, out);
+			MeshCache::save(path, importFlags, out);
+			return true;
+		}
+
 		// read file via ASSIMP
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+		const aiScene* scene = importer.ReadFile(path, importFlags);
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-			return;
+			return cached;
+		}
+
+		// convert every mesh of the scene on the thread pool
+		if (!cached)
+		{
+			processScene(scene, out);
+			MeshCache::save(path, importFlags, out);
 		}
+		// after the meshes, so the bones they are weighted to keep their offsets
+		if (clips)
+			*clips = Animation::readClips(scene, out.skeleton);
+		return true;
+	}
+
+	// converts the meshes of an OBJ file concurrently, in file order
+	static void processObj(const ObjLoader& obj, ModelData& out)
+	{
+		out.materials = obj.materials();
+		vector<vector<MeshGeometry>> parts(obj.meshCount());
+		ThreadPool::shared().parallelFor(obj.meshCount(), [&](size_t i)
+		{
+			MeshData data = obj.buildMesh(i);
+			parts[i] = finishMesh(data, out.materials[data.material], out.arena);
+		});
+
+		for (vector<MeshGeometry>& meshParts : parts)
+			for (MeshGeometry& part : meshParts)
+				out.meshes.push_back(std::move(part));
+	}
+
+	// converts an imported scene. The meshes are gathered in node order and their bones are
+	// registered serially so mesh order and bone ids stay deterministic, then every aiMesh is
+	// converted concurrently and its finished arrays are copied into out.arena.
+	static void processScene(const aiScene* scene, ModelData& out)
+	{
+		vector<aiMesh*> sceneMeshes;
+		processNode(scene->mRootNode, scene, sceneMeshes);
+
+		for (aiMesh* mesh : sceneMeshes)
+			RegisterBones(mesh, *out.skeleton);
+
+		// every material of the scene, so a mesh's aiMaterial index is its index in the model
+		out.materials.reserve(scene->mNumMaterials);
+		for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+			out.materials.push_back(processMaterial(scene->mMaterials[i]));
+
+		vector<vector<MeshGeometry>> parts(sceneMeshes.size());
+		ThreadPool::shared().parallelFor(sceneMeshes.size(), [&](size_t i)
+		{
+			parts[i] = processMesh(sceneMeshes[i], *out.skeleton, out.materials, out.arena);
+		});
+
+		for (vector<MeshGeometry>& meshParts : parts)
+			for (MeshGeometry& part : meshParts)
+				out.meshes.push_back(std::move(part));
+	}
+
+
+private:
+
+	std::shared_ptr<Skeleton> m_Skeleton;
+	vector<float> lodErrors;
+	// every vertex and index array of the model, released after upload unless the residency keeps it
+	GeometryArena geometry;
+
+	// creates the GL objects of an imported model on the context thread, the meshes upload straight from the arena
+	void createMeshes(string const& path, ModelData& data)
+	{
 		// retrieve the directory path of the filepath
 		directory = path.substr(0, path.find_last_of('/'));
 
-		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+		m_Skeleton = std::move(data.skeleton);
+
+		computeBounds(data.meshes);
+		if (residency == GeometryResidency::GpuWithCollision)
+			collision = buildCollisionMesh(data.meshes);
+
+		// sampler names, texture ids and constant slots resolved once, not on every draw
+		materials.reserve(data.materials.size());
+		for (const MaterialSource& source : data.materials)
+			materials.emplace_back(source, loadTextures(source.textures));
+
+		geometry = std::move(data.arena);
+		meshes.reserve(data.meshes.size());
+		for (MeshGeometry& meshGeometry : data.meshes)
+			meshes.emplace_back(meshGeometry.vertices, meshGeometry.indices, meshGeometry.material, meshGeometry.layout, std::move(meshGeometry.lods));
+		if (residency != GeometryResidency::KeepCpuCopy)
+		{
+			for (Mesh& mesh : meshes)
+				mesh.releaseCpuData();
+			geometry.release();
+		}
+
+		// a model level is as far off as its worst mesh, meshes with fewer levels repeat their last one
+		for (const Mesh& mesh : meshes)
+		{
+			if (mesh.lods.size() > lodErrors.size())
+				lodErrors.resize(mesh.lods.size(), 0.0f);
+		}
+		for (const Mesh& mesh : meshes)
+		{
+			for (size_t lod = 0; lod < lodErrors.size(); lod++)
+				lodErrors[lod] = std::max(lodErrors[lod], mesh.lods[std::min(lod, mesh.lods.size() - 1)].error);
+		}
+	}
+
+	void computeBounds(const vector<MeshGeometry>& meshData)
+	{
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+		for (const MeshGeometry& mesh : meshData)
+		{
+			for (const Vertex& vertex : mesh.vertices)
+			{
+				boundsMin = glm::min(boundsMin, vertex.Position);
+				boundsMax = glm::max(boundsMax, vertex.Position);
+			}
+		}
+		if (boundsMin.x > boundsMax.x)
+			boundsMin = boundsMax = glm::vec3(0.0f);
 	}
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode* node, const aiScene* scene)
+	// positions of the coarsest level of every mesh, the finer levels only add detail nothing collides with
+	static CollisionMesh buildCollisionMesh(const vector<MeshGeometry>& meshData)
 	{
-		// process each mesh located at the current node
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const { return std::hash<float>()(p.x) ^ (std::hash<float>()(p.y) * 31) ^ (std::hash<float>()(p.z) * 131); }
+		};
+
+		CollisionMesh collision;
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> welded;
+		for (const MeshGeometry& mesh : meshData)
+		{
+			if (mesh.lods.empty())
+				continue;
+			const MeshLod& lod = mesh.lods.back();
+			for (unsigned int i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i++)
+			{
+				const glm::vec3& position = mesh.vertices[mesh.indices[i]].Position;
+				auto inserted = welded.emplace(position, static_cast<unsigned int>(collision.positions.size()));
+				if (inserted.second)
+					collision.positions.push_back(position);
+				collision.indices.push_back(inserted.first->second);
+			}
+		}
+		collision.positions.shrink_to_fit();
+		collision.indices.shrink_to_fit();
+		return collision;
+	}
+
+	// processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+	static void processNode(aiNode* node, const aiScene* scene, vector<aiMesh*>& out)
+	{
+		// collect each mesh located at the current node
 		for (unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
 			// the node object only contains indices to index the actual objects in the scene. 
 			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			out.push_back(scene->mMeshes[node->mMeshes[i]]);
 		}
-		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+		// after we've collected all of the meshes (if any) we then recursively process each of the children nodes
 		for (unsigned int i = 0; i < node->mNumChildren; i++)
 		{
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, out);
 		}
 
 	}
 
-	void SetVertexBoneDataToDefault(Vertex& vertex)
+	static void SetVertexBoneDataToDefault(Vertex& vertex)
 	{
 		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
 		{
@@ -115,15 +347,23 @@ private:
 	}
 
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+	// converts one aiMesh
+	static vector<MeshGeometry> processMesh(aiMesh* mesh, const Skeleton& skeleton, const vector<MaterialSource>& materials, GeometryArena& arena)
 	{
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
+		// the staging arrays are sized once from the aiMesh and filled in place
+		MeshData data;
+		vector<Vertex>& vertices = data.vertices;
+		vector<unsigned int>& indices = data.indices;
+
+		size_t indexCount = 0;
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+			indexCount += mesh->mFaces[i].mNumIndices;
+		vertices.resize(mesh->mNumVertices);
+		indices.resize(indexCount);
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
-			Vertex vertex;
+			Vertex& vertex = vertices[i];
 			SetVertexBoneDataToDefault(vertex);
 			vertex.Position = AssimpGLMHelpers::GetGLMVec(mesh->mVertices[i]);
 			vertex.Normal = AssimpGLMHelpers::GetGLMVec(mesh->mNormals[i]);
@@ -137,32 +377,67 @@ private:
 			}
 			else
 				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-			vertices.push_back(vertex);
 		}
+		unsigned int* index = indices.data();
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
 		{
-			aiFace face = mesh->mFaces[i];
-			for (unsigned int j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
+			const aiFace& face = mesh->mFaces[i];
+			index = std::copy(face.mIndices, face.mIndices + face.mNumIndices, index);
 		}
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		data.material = mesh->mMaterialIndex;
 
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+		ExtractBoneWeightForVertices(vertices, mesh, skeleton);
+		return finishMesh(data, materials[data.material], arena);
+	}
 
-		ExtractBoneWeightForVertices(vertices, mesh, scene);
+	// the textures and constants of an aiMaterial, values it doesn't set keep their defaults
+	static MaterialSource processMaterial(const aiMaterial* material)
+	{
+		MaterialSource source;
+		aiString name;
+		if (material->Get(AI_MATKEY_NAME, name) == AI_SUCCESS)
+			source.name = name.C_Str();
+
+		collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", source.textures);
+		collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", source.textures);
+		collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", source.textures);
+		collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", source.textures);
+
+		aiColor3D color;
+		if (material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+			source.constants.diffuse = glm::vec4(color.r, color.g, color.b, 1.0f);
+		if (material->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
+			source.constants.specular = glm::vec4(color.r, color.g, color.b, 1.0f);
+		float shininess = 0.0f;
+		if (material->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS && shininess > 0.0f)
+			source.constants.shininess = shininess;
+		return source;
+	}
 
-		return Mesh(vertices, indices, textures);
+	// cooks a converted mesh for the GPU, its finished parts are copied into the arena and the staging arrays freed
+	static vector<MeshGeometry> finishMesh(MeshData& data, const MaterialSource& material, GeometryArena& arena)
+	{
+		// the importers emit every face corner as its own vertex, weld them and reorder for the GPU
+		MeshOptimizer::optimize(data);
+
+		// none of our shaders sample normal maps, so only meshes that have one keep tangents
+		const bool normalMapped = material.normalMapped();
+
+		// meshes too big for 16 bit indices are drawn in several parts
+		vector<MeshData> parts = MeshOptimizer::splitForShortIndices(data);
+		vector<MeshGeometry> geometry;
+		geometry.reserve(parts.size());
+		for (MeshData& part : parts)
+		{
+			MeshSimplifier::buildLods(part);
+			part.layout = VertexLayout::choose(part.vertices, normalMapped);
+			geometry.emplace_back(part, arena);
+			part = MeshData();
+		}
+		return geometry;
 	}
 
-	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
+	static void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
 	{
 		for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
 		{
@@ -176,29 +451,24 @@ private:
 	}
 
 
-	void ExtractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene)
+	// gives every bone of the mesh an id in the skeleton, must run serially in mesh order
+	static void RegisterBones(aiMesh* mesh, Skeleton& skeleton)
 	{
-		auto& boneInfoMap = m_BoneInfoMap;
-		int& boneCount = m_BoneCounter;
+		for (int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
+		{
+			skeleton.addBone(mesh->mBones[boneIndex]->mName.C_Str(),
+				AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix));
+		}
+	}
 
+	// only reads the skeleton, so meshes can be processed concurrently once RegisterBones ran
+	static void ExtractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const Skeleton& skeleton)
+	{
 		for (int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
 		{
-			int boneID = -1;
-			std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				BoneInfo newBoneInfo;
-				newBoneInfo.id = boneCount;
-				newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-				boneInfoMap[boneName] = newBoneInfo;
-				boneID = boneCount;
-				boneCount++;
-			}
-			else
-			{
-				boneID = boneInfoMap[boneName].id;
-			}
-			assert(boneID != -1);
+			const BoneInfo* boneInfo = skeleton.findBone(mesh->mBones[boneIndex]->mName.C_Str());
+			assert(boneInfo);
+			int boneID = boneInfo->id;
 			auto weights = mesh->mBones[boneIndex]->mWeights;
 			int numWeights = mesh->mBones[boneIndex]->mNumWeights;
 
@@ -213,75 +483,39 @@ private:
 	}
 
 
+	// takes a reference in the TextureCache, the image is only decoded if it isn't resident yet
 	unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false)
 	{
 		string filename = string(path);
 		filename = directory + '/' + filename;
 
-		unsigned int textureID;
-		glGenTextures(1, &textureID);
+		return TextureCache::instance().acquire(filename);
+	}
 
-		int width, height, nrComponents;
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			GLenum format;
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-
-			glBindTexture(GL_TEXTURE_2D, textureID);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
+	// records the texture paths of a given type used by a material, they are loaded once the mesh reaches the GL thread.
+	static void collectMaterialTextures(const aiMaterial* mat, aiTextureType type, const string& typeName, vector<TextureSource>& out)
+	{
+		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 		{
-			std::cout << "Texture failed to load at path: " << path << std::endl;
-			stbi_image_free(data);
+			aiString str;
+			mat->GetTexture(type, i, &str);
+			out.push_back({ typeName, str.C_Str() });
 		}
-
-		return textureID;
 	}
 
-	// checks all material textures of a given type and loads the textures if they're not loaded yet.
-	// the required info is returned as a Texture struct.
-	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+	// resolves the textures of a material through the process wide TextureCache, which only loads
+	// images that are not resident yet. the required info is returned as Texture structs.
+	vector<Texture> loadTextures(const vector<TextureSource>& sources)
 	{
 		vector<Texture> textures;
-		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+		for (const TextureSource& source : sources)
 		{
-			aiString str;
-			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-			}
+			Texture texture;
+			texture.id = TextureFromFile(source.path.c_str(), this->directory);
+			texture.type = source.type;
+			texture.path = source.path;
+			textures.push_back(texture);
+			textures_loaded.push_back(texture);
 		}
 		return textures;
 	}
@@ -346,7 +580,8 @@ public:
 		m_isDirty = true;
 	}
 
-	const glm::vec3& getGlobalPosition() const
+	// by value, the position is built from the matrix's column
+	glm::vec3 getGlobalPosition() const
 	{
 		return glm::vec3(m_modelMatrix[3]);
 	}
@@ -624,45 +859,30 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 	return frustum;
 }
 
-AABB generateAABB(const Model& model)
+// camera data for level of detail selection
+struct LodView
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+	glm::vec3 position;
+	// pixels covered by one world unit at distance one, the projection scale along the vertical axis
+	float pixelsPerUnit;
+	// which of Entity::lods keeps the level drawn last in this view
+	unsigned int slot;
+};
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
-	}
-	return AABB(minAABB, maxAABB);
+LodView createLodViewFromCamera(const Camera& cam, float fovY, float viewportHeight, unsigned int slot = 0)
+{
+	return { cam.Position, viewportHeight * 0.5f / tanf(fovY * 0.5f), slot };
 }
 
-Sphere generateSphereBV(const Model& model)
+AABB generateAABB(const Model& model)
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
-
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
-	}
+	// bounds are kept by the model, the vertex arrays may already be freed
+	return AABB(model.boundsMin, model.boundsMax);
+}
 
-	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
+Sphere generateSphereBV(const Model& model)
+{
+	return Sphere((model.boundsMax + model.boundsMin) * 0.5f, glm::length(model.boundsMin - model.boundsMax));
 }
 
 class Entity
@@ -678,6 +898,16 @@ public:
 	Model* pModel = nullptr;
 	std::unique_ptr<AABB> boundingVolume;
 
+	// level of detail drawn last in every view, kept between frames for the hysteresis. Slot 0 is
+	// the main camera, slot 1 the spy camera
+	static constexpr unsigned int lodViews = 2;
+	unsigned int lods[lodViews] = {};
+
+	// a level is used while its error projects to at most this many pixels
+	static constexpr float lodPixelError = 1.0f;
+	// switching to a coarser level needs this much headroom, so an entity at the boundary doesn't flicker
+	static constexpr float lodHysteresis = 0.75f;
+
 
 	// constructor, expects a filepath to a 3D model.
 	Entity(Model& model) : pModel{ &model }
@@ -711,6 +941,52 @@ public:
 		return AABB(globalCenter, newIi, newIj, newIk);
 	}
 
+	// picks the coarsest level whose largest error covers no more than lodPixelError pixels on
+	// screen, measured at the point of the bounding volume nearest to the camera
+	unsigned int selectLod(const LodView& view)
+	{
+		const AABB bounds = getGlobalAABB();
+		const glm::vec3 scale = transform.getLocalScale();
+		return selectLod(view, bounds.center, glm::length(bounds.extents), std::max(scale.x, std::max(scale.y, scale.z)));
+	}
+
+	// the same for a draw placed with its own model matrix instead of the entity's transform
+	unsigned int selectLod(const LodView& view, const glm::mat4& model)
+	{
+		const glm::vec3 center = glm::vec3(model * glm::vec4(boundingVolume->center, 1.0f));
+		const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		return selectLod(view, center, glm::length(boundingVolume->extents) * scale, scale);
+	}
+
+	// bounds as a world space center and radius, scale converts the model's units to world units
+	unsigned int selectLod(const LodView& view, const glm::vec3& center, float radius, float scale)
+	{
+		unsigned int& lod = lods[view.slot];
+		if (!pModel || pModel->lodCount() <= 1)
+			return lod = 0;
+
+		const float distance = std::max(glm::length(center - view.position) - radius, 1e-3f);
+		const float pixelsPerModelUnit = view.pixelsPerUnit / distance * scale;
+
+		// the coarsest level that is still fine at this distance, and the coarsest with headroom to spare
+		unsigned int coarsestAllowed = 0, coarsestWithHeadroom = 0;
+		for (unsigned int level = 1; level < pModel->lodCount(); level++)
+		{
+			const float pixels = pModel->lodError(level) * pixelsPerModelUnit;
+			if (pixels <= lodPixelError)
+				coarsestAllowed = level;
+			if (pixels <= lodPixelError * lodHysteresis)
+				coarsestWithHeadroom = level;
+		}
+
+		// a level too coarse is refined right away, a coarser one is only taken with headroom
+		if (lod > coarsestAllowed)
+			lod = coarsestAllowed;
+		else if (lod < coarsestWithHeadroom)
+			lod = coarsestWithHeadroom;
+		return lod;
+	}
+
 	//Add child. Argument input is argument of any constructor that you create. By default you can use the default constructor and don't put argument input.
 	template<typename... TArgs>
 	void addChild(TArgs&... args)
@@ -743,19 +1019,19 @@ public:
 	}
 
 
-	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
+	void drawSelfAndChild(const Frustum& frustum, const LodView& view, Shader& ourShader, unsigned int& display, unsigned int& total)
 	{
 		if (boundingVolume->isOnFrustum(frustum, transform))
 		{
 			ourShader.setMat4("model", transform.getModelMatrix());
-			pModel->Draw(ourShader);
+			pModel->Draw(ourShader, selectLod(view));
 			display++;
 		}
 		total++;
 
 		for (auto&& child : children)
 		{
-			child->drawSelfAndChild(frustum, ourShader, display, total);
+			child->drawSelfAndChild(frustum, view, ourShader, display, total);
 		}
 	}
 
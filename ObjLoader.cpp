@@ -0,0 +1,635 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OBJ_LOADER_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// files smaller than this are parsed on one thread
+	const size_t minChunkSize = 256 * 1024;
+
+	const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const uint64_t integerPowersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+	inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+	inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		return p;
+	}
+
+	// rest of the line without surrounding whitespace
+	std::string restOfLine(const char* p, const char* end)
+	{
+		p = skipSpaces(p, end);
+		while (end > p && isSpace(end[-1]))
+			end--;
+		return std::string(p, end);
+	}
+
+	inline unsigned int countTrailingZeros(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	// length of the run of decimal digits at p
+	size_t digitRun(const char* p, const char* end)
+	{
+		size_t n = 0;
+#ifdef OBJ_LOADER_SSE2
+		// 16 bytes at a time: a byte is a digit if it is at most 9 after subtracting '0', as unsigned
+		const __m128i zero = _mm_set1_epi8('0');
+		const __m128i nine = _mm_set1_epi8(9);
+		while (end - (p + n) >= 16)
+		{
+			__m128i digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n)), zero);
+			__m128i isDigitMask = _mm_cmpeq_epi8(_mm_min_epu8(digits, nine), digits);
+			unsigned int others = ~static_cast<unsigned int>(_mm_movemask_epi8(isDigitMask)) & 0xFFFF;
+			if (others)
+				return n + countTrailingZeros(others);
+			n += 16;
+		}
+#endif
+		while (p + n < end && isDigit(p[n]))
+			n++;
+		return n;
+	}
+
+	// value of the count <= 8 digits at p
+	uint32_t parseDigits(const char* p, size_t count, const char* end)
+	{
+#ifdef OBJ_LOADER_SSE2
+		if (count > 1 && end - p >= 8)
+		{
+			// bytes to 0-9 and shifted so the digits end at the top, what follows them is shifted
+			// out (including borrows from subtracting) and zeros come in as leading digits
+			uint64_t bytes;
+			std::memcpy(&bytes, p, sizeof(bytes));
+			bytes = (bytes - 0x3030303030303030ull) << (8 * (8 - count));
+
+			// combine neighbours: pairs of digits, then of 2 digit numbers, then of 4 digit numbers
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&bytes)), _mm_setzero_si128());
+			v = _mm_madd_epi16(v, _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+			v = _mm_packs_epi32(v, v);
+			v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+			v = _mm_packs_epi32(v, v);
+			v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+			return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+		}
+#endif
+		uint32_t value = 0;
+		for (size_t i = 0; i < count; i++)
+			value = value * 10 + (p[i] - '0');
+		return value;
+	}
+
+	// OBJ indices start at 1, negative ones count back from the last element read so far
+	const char* parseIndex(const char* p, const char* end, size_t readSoFar, int& index)
+	{
+		bool negative = p < end && *p == '-';
+		if (negative)
+			p++;
+		size_t digits = digitRun(p, end);
+		if (digits == 0 || digits > 9)
+			return nullptr;
+		int64_t value = digits > 8 ? int64_t(parseDigits(p, 8, end)) * 10 + (p[8] - '0') : parseDigits(p, digits, end);
+		if (value == 0)
+			return nullptr;
+		index = static_cast<int>(negative ? int64_t(readSoFar) - value : value - 1);
+		return index < 0 ? nullptr : p + digits;
+	}
+
+	// appends the digits to mantissa, leading zeros are skipped and at most 18 significant digits
+	// are kept, more than a float can use. Returns how many digits went into the value.
+	size_t appendDigits(const char* p, size_t count, const char* end, uint64_t& mantissa, size_t& significant)
+	{
+		size_t used = 0;
+		while (mantissa == 0 && used < count && p[used] == '0')
+			used++;
+		const size_t take = std::min(count - used, 18 - significant);
+		for (size_t i = 0; i < take; i += 8)
+		{
+			const size_t n = std::min<size_t>(8, take - i);
+			mantissa = mantissa * integerPowersOf10[n] + parseDigits(p + used + i, n, end);
+		}
+		significant += take;
+		return used + take;
+	}
+}
+
+const char* ObjLoader::parseFloat(const char* p, const char* end, float& value)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	size_t significant = 0;
+	int exponent = 0;
+
+	const size_t integerDigits = digitRun(p, end);
+	exponent += static_cast<int>(integerDigits - appendDigits(p, integerDigits, end, mantissa, significant));
+	p += integerDigits;
+
+	size_t fractionDigits = 0;
+	if (p < end && *p == '.')
+	{
+		p++;
+		fractionDigits = digitRun(p, end);
+		exponent -= static_cast<int>(appendDigits(p, fractionDigits, end, mantissa, significant));
+		p += fractionDigits;
+	}
+	if (integerDigits == 0 && fractionDigits == 0)
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool negativeExponent = q < end && *q == '-';
+		if (q < end && (*q == '-' || *q == '+'))
+			q++;
+		size_t digits = digitRun(q, end);
+		if (digits > 0 && digits <= 4)
+		{
+			int explicitExponent = static_cast<int>(parseDigits(q, digits, end));
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			p = q + digits;
+		}
+	}
+
+	// exact powers of ten keep the result correctly rounded as a double before it becomes a float
+	double result = static_cast<double>(mantissa);
+	if (mantissa != 0)
+	{
+		const int magnitude = std::abs(exponent);
+		const double scale = magnitude <= 22 ? powersOf10[magnitude] : std::pow(10.0, magnitude);
+		result = exponent < 0 ? result / scale : result * scale;
+	}
+	value = static_cast<float>(negative ? -result : result);
+	return p;
+}
+
+bool ObjLoader::handles(const std::string& path)
+{
+	if (path.size() < 4)
+		return false;
+	std::string extension = path.substr(path.size() - 4);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return extension == ".obj";
+}
+
+void ObjLoader::count(Chunk& chunk)
+{
+	for (const char* p = chunk.begin; p < chunk.end;)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+		if (!lineEnd)
+			lineEnd = chunk.end;
+		p = skipSpaces(p, lineEnd);
+		if (lineEnd - p >= 2 && p[0] == 'v')
+		{
+			// must match what parse() reads
+			if (isSpace(p[1]))
+				chunk.positions++;
+			else if (lineEnd - p >= 3 && p[1] == 't' && isSpace(p[2]))
+				chunk.texCoords++;
+			else if (lineEnd - p >= 3 && p[1] == 'n' && isSpace(p[2]))
+				chunk.normals++;
+		}
+		p = lineEnd + 1;
+	}
+}
+
+void ObjLoader::parse(Chunk& chunk, const char* fileEnd)
+{
+	float* positions = m_Positions.data() + chunk.positionBase * 3;
+	float* texCoords = m_TexCoords.data() + chunk.texCoordBase * 2;
+	float* normals = m_Normals.data() + chunk.normalBase * 3;
+	size_t positionCount = chunk.positionBase, texCoordCount = chunk.texCoordBase, normalCount = chunk.normalBase;
+
+	// reads count floats of the line into out, extra ones (w of v, w of vt) are ignored
+	auto readFloats = [&](const char* p, const char* lineEnd, float* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			p = skipSpaces(p, lineEnd);
+			if (p >= lineEnd || !(p = parseFloat(p, fileEnd, out[i])))
+				return false;
+		}
+		return true;
+	};
+
+	for (const char* p = chunk.begin; p < chunk.end && !chunk.failed;)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+		if (!lineEnd)
+			lineEnd = chunk.end;
+		p = skipSpaces(p, lineEnd);
+		const size_t length = lineEnd - p;
+
+		if (length >= 2 && p[0] == 'v' && isSpace(p[1]))
+		{
+			chunk.failed = !readFloats(p + 2, lineEnd, positions, 3);
+			positions += 3;
+			positionCount++;
+		}
+		else if (length >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+		{
+			// a missing v defaults to 0 like in ASSIMP
+			texCoords[1] = 0.0f;
+			const char* q = skipSpaces(p + 3, lineEnd);
+			chunk.failed = !(q = parseFloat(q, fileEnd, texCoords[0]));
+			if (!chunk.failed && (q = skipSpaces(q, lineEnd)) < lineEnd)
+				chunk.failed = !parseFloat(q, fileEnd, texCoords[1]);
+			texCoords += 2;
+			texCoordCount++;
+		}
+		else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+		{
+			chunk.failed = !readFloats(p + 3, lineEnd, normals, 3);
+			normals += 3;
+			normalCount++;
+		}
+		else if (length >= 2 && p[0] == 'f' && isSpace(p[1]))
+		{
+			unsigned int corners = 0;
+			for (const char* q = skipSpaces(p + 2, lineEnd); q < lineEnd && !chunk.failed; q = skipSpaces(q, lineEnd))
+			{
+				int position, texCoord = -1, normal = -1;
+				q = parseIndex(q, fileEnd, positionCount, position);
+				if (q && q < lineEnd && *q == '/')
+				{
+					q++;
+					if (q < lineEnd && *q != '/')
+						q = parseIndex(q, fileEnd, texCoordCount, texCoord);
+					if (q && q < lineEnd && *q == '/')
+						q = parseIndex(q + 1, fileEnd, normalCount, normal);
+				}
+				if (!q)
+				{
+					chunk.failed = true;
+					break;
+				}
+				chunk.corners.insert(chunk.corners.end(), { position, texCoord, normal });
+				corners++;
+			}
+			// lines and points are not drawn, like ASSIMP's output after triangulation they are dropped
+			if (corners >= 3)
+				chunk.faces.push_back(corners);
+			else
+				chunk.corners.resize(chunk.corners.size() - corners * 3);
+		}
+		else if (length >= 2 && (p[0] == 'o' || p[0] == 'g') && isSpace(p[1]))
+			chunk.events.push_back({ chunk.faces.size(), false, restOfLine(p + 2, lineEnd) });
+		else if (length >= 7 && std::memcmp(p, "usemtl", 6) == 0 && isSpace(p[6]))
+			chunk.events.push_back({ chunk.faces.size(), true, restOfLine(p + 7, lineEnd) });
+		else if (length >= 7 && std::memcmp(p, "mtllib", 6) == 0 && isSpace(p[6]))
+			chunk.libraries.push_back(restOfLine(p + 7, lineEnd));
+
+		p = lineEnd + 1;
+	}
+}
+
+bool ObjLoader::loadMaterials(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	// the same texture types Model collects from an aiMaterial, in the same order
+	const std::pair<const char*, const char*> maps[] = {
+		{ "map_Kd", "texture_diffuse" },
+		{ "map_Ks", "texture_specular" },
+		{ "map_Bump", "texture_normal" },
+		{ "map_bump", "texture_normal" },
+		{ "bump", "texture_normal" },
+		{ "map_Ka", "texture_height" },
+	};
+	const char* order[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+	std::string line;
+	const size_t first = m_Materials.size();
+	MaterialSource* current = nullptr;
+	while (std::getline(file, line))
+	{
+		const char* begin = skipSpaces(line.data(), line.data() + line.size());
+		const char* end = line.data() + line.size();
+		const char* keyEnd = begin;
+		while (keyEnd < end && !isSpace(*keyEnd))
+			keyEnd++;
+		const std::string key(begin, keyEnd);
+
+		if (key == "newmtl")
+		{
+			m_Materials.push_back(MaterialSource());
+			current = &m_Materials.back();
+			current->name = restOfLine(keyEnd, end);
+			continue;
+		}
+		if (!current)
+			continue;
+
+		// a colour is three numbers, a single one is grey
+		if (key == "Kd" || key == "Ks")
+		{
+			float rgb[3];
+			const char* p = keyEnd;
+			int n = 0;
+			while (n < 3 && (p = parseFloat(skipSpaces(p, end), end, rgb[n])))
+				n++;
+			if (n == 0)
+				continue;
+			glm::vec4 color(n == 3 ? glm::vec3(rgb[0], rgb[1], rgb[2]) : glm::vec3(rgb[0]), 1.0f);
+			(key == "Kd" ? current->constants.diffuse : current->constants.specular) = color;
+			continue;
+		}
+		if (key == "Ns")
+		{
+			float shininess;
+			if (parseFloat(skipSpaces(keyEnd, end), end, shininess) && shininess > 0.0f)
+				current->constants.shininess = shininess;
+			continue;
+		}
+		for (const auto& map : maps)
+		{
+			if (key != map.first)
+				continue;
+			// options like -bm 0.5 come first, the file name is the last token
+			std::string value = restOfLine(keyEnd, end);
+			size_t space = value.find_last_of(" \t");
+			current->textures.push_back({ map.second, space == std::string::npos ? value : value.substr(space + 1) });
+		}
+	}
+
+	for (size_t i = first; i < m_Materials.size(); i++)
+	{
+		std::vector<TextureSource>& textures = m_Materials[i].textures;
+		std::stable_sort(textures.begin(), textures.end(), [&](const TextureSource& a, const TextureSource& b)
+		{
+			auto rank = [&](const std::string& type) { return std::find_if(std::begin(order), std::end(order), [&](const char* t) { return type == t; }) - std::begin(order); };
+			return rank(a.type) < rank(b.type);
+		});
+	}
+	return true;
+}
+
+bool ObjLoader::open(const std::string& path)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return false;
+	const char* data = reinterpret_cast<const char*>(file.data());
+	const char* end = data + file.size();
+
+	// cut at line ends, a few chunks per worker so uneven chunks even out
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(file.size() / minChunkSize, pool.size() * 4));
+	m_Chunks.clear();
+	const char* begin = data;
+	for (size_t i = 1; i <= chunkCount && begin < end; i++)
+	{
+		const char* cut = i == chunkCount ? end : data + file.size() * i / chunkCount;
+		if (cut < begin)
+			cut = begin;
+		const char* lineEnd = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+		cut = lineEnd ? lineEnd + 1 : end;
+		Chunk chunk;
+		chunk.begin = begin;
+		chunk.end = cut;
+		m_Chunks.push_back(chunk);
+		begin = cut;
+	}
+
+	// first pass: element counts, so every chunk knows where its attributes go
+	pool.parallelFor(m_Chunks.size(), [&](size_t i) { count(m_Chunks[i]); });
+	size_t positions = 0, texCoords = 0, normals = 0;
+	for (Chunk& chunk : m_Chunks)
+	{
+		chunk.positionBase = positions;
+		chunk.texCoordBase = texCoords;
+		chunk.normalBase = normals;
+		positions += chunk.positions;
+		texCoords += chunk.texCoords;
+		normals += chunk.normals;
+	}
+	m_Positions.resize(positions * 3);
+	m_TexCoords.resize(texCoords * 2);
+	m_Normals.resize(normals * 3);
+
+	// second pass: the numbers, written straight to their place
+	pool.parallelFor(m_Chunks.size(), [&](size_t i) { parse(m_Chunks[i], end); });
+	for (const Chunk& chunk : m_Chunks)
+	{
+		if (chunk.failed)
+		{
+			std::cout << "ERROR::OBJLOADER:: could not parse " << path << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < chunk.corners.size(); i += 3)
+		{
+			if (size_t(chunk.corners[i]) >= positions || chunk.corners[i + 1] >= int(texCoords) || chunk.corners[i + 2] >= int(normals))
+			{
+				std::cout << "ERROR::OBJLOADER:: index out of range in " << path << std::endl;
+				return false;
+			}
+		}
+	}
+
+	// materials of every library the file references
+	const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	m_Materials.assign(1, MaterialSource());
+	for (const Chunk& chunk : m_Chunks)
+		for (const std::string& library : chunk.libraries)
+			loadMaterials(directory + library);
+
+	// group the faces by object and material in the order they first appear
+	std::map<std::pair<std::string, std::string>, size_t> meshIndex;
+	std::string object, material;
+	m_Meshes.clear();
+	auto addRange = [&](const Chunk& chunk, size_t firstFace, size_t lastFace, size_t& corner)
+	{
+		if (firstFace == lastFace)
+			return;
+		auto inserted = meshIndex.emplace(std::make_pair(object, material), m_Meshes.size());
+		if (inserted.second)
+		{
+			ObjMesh mesh;
+			for (size_t i = 1; i < m_Materials.size(); i++)
+			{
+				if (m_Materials[i].name == material)
+				{
+					mesh.material = static_cast<unsigned int>(i);
+					break;
+				}
+			}
+			m_Meshes.push_back(mesh);
+		}
+		m_Meshes[inserted.first->second].ranges.push_back({ &chunk, firstFace, lastFace - firstFace, corner });
+		for (size_t face = firstFace; face < lastFace; face++)
+			corner += chunk.faces[face];
+	};
+	for (const Chunk& chunk : m_Chunks)
+	{
+		size_t face = 0, corner = 0;
+		for (const Event& event : chunk.events)
+		{
+			addRange(chunk, face, event.face, corner);
+			face = event.face;
+			(event.material ? material : object) = event.name;
+		}
+		addRange(chunk, face, chunk.faces.size(), corner);
+	}
+	return true;
+}
+
+MeshData ObjLoader::buildMesh(size_t index) const
+{
+	const ObjMesh& objMesh = m_Meshes[index];
+
+	size_t cornerCount = 0, triangleCount = 0;
+	for (const FaceRange& range : objMesh.ranges)
+	{
+		for (size_t face = range.firstFace; face < range.firstFace + range.faceCount; face++)
+		{
+			cornerCount += range.chunk->faces[face];
+			triangleCount += range.chunk->faces[face] - 2;
+		}
+	}
+
+	MeshData mesh;
+	mesh.material = objMesh.material;
+	mesh.vertices.resize(cornerCount);
+	mesh.indices.resize(triangleCount * 3);
+
+	bool missingNormals = false;
+	Vertex* vertex = mesh.vertices.data();
+	unsigned int* outIndex = mesh.indices.data();
+	unsigned int first = 0;
+	for (const FaceRange& range : objMesh.ranges)
+	{
+		const int* corner = range.chunk->corners.data() + range.firstCorner * 3;
+		for (size_t face = range.firstFace; face < range.firstFace + range.faceCount; face++)
+		{
+			const unsigned int corners = range.chunk->faces[face];
+			for (unsigned int c = 0; c < corners; c++, corner += 3, vertex++)
+			{
+				vertex->Position = glm::vec3(m_Positions[corner[0] * 3], m_Positions[corner[0] * 3 + 1], m_Positions[corner[0] * 3 + 2]);
+				if (corner[1] >= 0)
+					vertex->TexCoords = glm::vec2(m_TexCoords[corner[1] * 2], m_TexCoords[corner[1] * 2 + 1]);
+				if (corner[2] >= 0)
+					vertex->Normal = glm::vec3(m_Normals[corner[2] * 3], m_Normals[corner[2] * 3 + 1], m_Normals[corner[2] * 3 + 2]);
+				else
+					missingNormals = true;
+				for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+					vertex->m_BoneIDs[i] = -1;
+			}
+			// fan, the same split ASSIMP makes for convex polygons
+			for (unsigned int c = 1; c + 1 < corners; c++)
+			{
+				*outIndex++ = first;
+				*outIndex++ = first + c;
+				*outIndex++ = first + c + 1;
+			}
+			first += corners;
+		}
+	}
+
+	// like aiProcess_GenSmoothNormals: corners without a normal get the area weighted average of
+	// the faces around their position
+	if (missingNormals)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const { return std::hash<float>()(p.x) ^ (std::hash<float>()(p.y) * 31) ^ (std::hash<float>()(p.z) * 131); }
+		};
+		std::unordered_map<glm::vec3, glm::vec3, PositionHash> smooth;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			const Vertex* triangle[3] = { &mesh.vertices[mesh.indices[i]], &mesh.vertices[mesh.indices[i + 1]], &mesh.vertices[mesh.indices[i + 2]] };
+			const glm::vec3 normal = glm::cross(triangle[1]->Position - triangle[0]->Position, triangle[2]->Position - triangle[0]->Position);
+			for (const Vertex* v : triangle)
+				smooth[v->Position] += normal;
+		}
+		vertex = mesh.vertices.data();
+		for (const FaceRange& range : objMesh.ranges)
+		{
+			const int* corner = range.chunk->corners.data() + range.firstCorner * 3;
+			for (size_t face = range.firstFace; face < range.firstFace + range.faceCount; face++)
+			{
+				for (unsigned int c = 0; c < range.chunk->faces[face]; c++, corner += 3, vertex++)
+				{
+					if (corner[2] < 0)
+					{
+						const glm::vec3 sum = smooth[vertex->Position];
+						const float length = glm::length(sum);
+						vertex->Normal = length > 0.0f ? sum / length : glm::vec3(0.0f);
+					}
+				}
+			}
+		}
+	}
+
+	// like aiProcess_CalcTangentSpace, only meshes with a normal map keep a tangent frame
+	const bool normalMapped = m_Materials[objMesh.material].normalMapped();
+	if (normalMapped)
+	{
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			Vertex& v0 = mesh.vertices[mesh.indices[i]];
+			Vertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+			Vertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+			const glm::vec3 edge1 = v1.Position - v0.Position, edge2 = v2.Position - v0.Position;
+			const glm::vec2 uv1 = v1.TexCoords - v0.TexCoords, uv2 = v2.TexCoords - v0.TexCoords;
+			const float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+			if (determinant == 0.0f)
+				continue;
+			const glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) / determinant;
+			const glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) / determinant;
+			for (Vertex* v : { &v0, &v1, &v2 })
+			{
+				v->Tangent += tangent;
+				v->Bitangent += bitangent;
+			}
+		}
+		for (Vertex& v : mesh.vertices)
+		{
+			// orthogonal to the normal, as the shaders expect
+			const glm::vec3 tangent = v.Tangent - v.Normal * glm::dot(v.Normal, v.Tangent);
+			const glm::vec3 bitangent = v.Bitangent - v.Normal * glm::dot(v.Normal, v.Bitangent);
+			v.Tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(0.0f);
+			v.Bitangent = glm::length(bitangent) > 0.0f ? glm::normalize(bitangent) : glm::vec3(0.0f);
+		}
+	}
+	return mesh;
+}
@@ -0,0 +1,90 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+// Native reader for Wavefront OBJ files and their MTL libraries, used by Model::importModel in
+// place of ASSIMP. The file is memory mapped and cut into chunks at line ends that are parsed on
+// the thread pool: a first pass counts the v/vt/vn lines of every chunk, so the second pass can
+// write each chunk's attributes straight to its place in the file wide arrays and resolve face
+// indices as it goes. Numbers are parsed with SSE2 on x64.
+// The output matches what Model's ASSIMP path converts: one mesh per object (o/g) and material,
+// one vertex per face corner, polygons fanned into triangles, smooth normals where the file has
+// none, and the material's diffuse/specular/bump/ambient maps and Kd/Ks/Ns constants.
+class ObjLoader
+{
+public:
+	static bool handles(const std::string& path);
+
+	// reads the file, returns false if it can't be read or is malformed
+	bool open(const std::string& path);
+
+	size_t meshCount() const { return m_Meshes.size(); }
+
+	// converts one mesh of the file, different meshes can be built concurrently
+	MeshData buildMesh(size_t index) const;
+
+	// the materials MeshData::material indexes, the first is the default for faces without one
+	const std::vector<MaterialSource>& materials() const { return m_Materials; }
+
+	// parses the decimal number at p, returns the end of it or nullptr if there is none.
+	// Reads up to 16 bytes ahead, but never at or beyond end.
+	static const char* parseFloat(const char* p, const char* end, float& value);
+
+private:
+	struct Event
+	{
+		size_t face;    // applies from this face of the chunk on
+		bool material;  // usemtl, otherwise o/g
+		std::string name;
+	};
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		size_t positions = 0;
+		size_t texCoords = 0;
+		size_t normals = 0;
+		size_t positionBase = 0;
+		size_t texCoordBase = 0;
+		size_t normalBase = 0;
+
+		std::vector<int> corners;         // position, uv and normal index per corner, 0 based, -1 if absent
+		std::vector<unsigned int> faces;  // corner count of every face
+		std::vector<Event> events;
+		std::vector<std::string> libraries;
+		bool failed = false;
+	};
+
+	// consecutive faces of one chunk that belong to the same mesh
+	struct FaceRange
+	{
+		const Chunk* chunk;
+		size_t firstFace;
+		size_t faceCount;
+		size_t firstCorner;
+	};
+
+	struct ObjMesh
+	{
+		std::vector<FaceRange> ranges;
+		unsigned int material = 0;
+	};
+
+	static void count(Chunk& chunk);
+	void parse(Chunk& chunk, const char* fileEnd);
+	bool loadMaterials(const std::string& path);
+
+	std::vector<float> m_Positions;
+	std::vector<float> m_TexCoords;
+	std::vector<float> m_Normals;
+	std::vector<Chunk> m_Chunks;
+	std::vector<ObjMesh> m_Meshes;
+	std::vector<MaterialSource> m_Materials;
+};
+
+#endif
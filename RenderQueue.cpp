@@ -0,0 +1,334 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "ShaderBuildQueue.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	// bit positions of the key fields, see RenderQueue
+	const int viewShift = 60;
+	const int programShift = 48;
+	const int materialShift = 32;
+	const int poolShift = 28;
+	const int meshShift = 16;
+	const int levelShift = 12;
+
+	size_t indexSize(GLenum indexType)
+	{
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+}
+
+void RenderQueue::setup()
+{
+	glGenBuffers(1, &m_InstanceBuffer);
+	glGenBuffers(1, &m_CommandBuffer);
+	m_InstanceCapacity = 0;
+}
+
+void RenderQueue::Delete()
+{
+	GLState::instance().deleteBuffer(m_InstanceBuffer);
+	GLState::instance().deleteBuffer(m_CommandBuffer);
+	m_InstanceBuffer = m_CommandBuffer = 0;
+	m_InstanceCapacity = 0;
+}
+
+bool RenderQueue::multiDraw() const
+{
+	return m_MultiDraw && GLAD_GL_VERSION_4_3;
+}
+
+void RenderQueue::clear()
+{
+	m_Packets.clear();
+	m_Order.clear();
+	m_Shaders.clear();
+	m_ShaderIndex.clear();
+	m_Materials.clear();
+	m_MaterialIndex.clear();
+	m_MeshIndex.clear();
+}
+
+uint32_t RenderQueue::internShader(const Shader& shader)
+{
+	auto inserted = m_ShaderIndex.emplace(shader.ID, static_cast<uint32_t>(m_Shaders.size()));
+	if (inserted.second)
+		m_Shaders.push_back(shader);
+	return inserted.first->second;
+}
+
+uint32_t RenderQueue::internMaterial(const Material& material, GLuint texture)
+{
+	// the slot is unique among live materials, the fallback only matters without textures
+	const GLuint fallback = material.bindings().empty() ? texture : 0;
+	const uint64_t key = uint64_t(material.slot()) << 32 | fallback;
+	auto inserted = m_MaterialIndex.emplace(key, static_cast<uint32_t>(m_Materials.size()));
+	if (inserted.second)
+		m_Materials.push_back({ &material, fallback });
+	return inserted.first->second;
+}
+
+// the meshes of a pool share its VAO, so they are told apart by their slice, numbered in the order
+// the frame first queues them to fit the key
+uint32_t RenderQueue::internMesh(const Mesh& mesh)
+{
+	const uint64_t key = uint64_t(mesh.geometry.pool) << 32 | mesh.geometry.firstIndex;
+	return m_MeshIndex.emplace(key, static_cast<uint32_t>(m_MeshIndex.size())).first->second;
+}
+
+void RenderQueue::add(const Shader& shader, FrameUniforms::View view, const Mesh& mesh, const Material& material, unsigned int lod, GLuint texture, const glm::mat4& model, float depth)
+{
+	const size_t level = std::min<size_t>(lod, mesh.lods.size() - 1);
+	const MeshLod& range = mesh.lods[level];
+	m_Packets.push_back({ internShader(shader), view, internMaterial(material, texture), mesh.VAO, mesh.indexType,
+		range.indexCount, mesh.geometry.firstIndex + range.indexOffset, mesh.geometry.baseVertex, model });
+
+	// the mesh and level ahead of the depth keep the instances of one index range together, the pool
+	// ahead of the mesh keeps the meshes of one VAO together for a multi draw
+	const float steps = std::min(std::max(depth, 0.0f) / maxDepth, 1.0f) * 4095.0f;
+	const Packet& packet = m_Packets.back();
+	SortEntry entry;
+	entry.key = (uint64_t(view) & 0xF) << viewShift
+		| (uint64_t(shader.ID) & 0xFFF) << programShift
+		| (uint64_t(packet.material) & 0xFFFF) << materialShift
+		| (uint64_t(mesh.geometry.pool) & 0xF) << poolShift
+		| (uint64_t(internMesh(mesh)) & 0xFFF) << meshShift
+		| uint64_t(std::min<size_t>(level, 15)) << levelShift
+		| uint64_t(steps);
+	entry.packet = static_cast<uint32_t>(m_Packets.size() - 1);
+	m_Order.push_back(entry);
+}
+
+bool RenderQueue::isInstanced(const Shader& shader)
+{
+	auto it = m_InstancedPrograms.find(shader.ID);
+	if (it != m_InstancedPrograms.end())
+		return it->second;
+	ShaderBuildQueue::instance().finish(shader.ID);
+	const bool instanced = glGetAttribLocation(shader.ID, "aInstanceModel") == static_cast<GLint>(instanceLocation);
+	m_InstancedPrograms.emplace(shader.ID, instanced);
+	return instanced;
+}
+
+// splits the sorted packets into batches of the same state. A batch of an instanced program gets
+// a command for every run of packets that only differs in the model matrix, their matrices are
+// appended to m_Instances
+void RenderQueue::buildBatches()
+{
+	m_Batches.clear();
+	m_Instances.clear();
+	m_Commands.clear();
+	const uint32_t count = static_cast<uint32_t>(m_Order.size());
+	for (uint32_t first = 0; first < count;)
+	{
+		const Packet& packet = m_Packets[m_Order[first].packet];
+		Batch batch = { first, 1, static_cast<uint32_t>(m_Commands.size()), 0, isInstanced(m_Shaders[packet.shader]) };
+		if (!batch.instanced)
+		{
+			m_Batches.push_back(batch);
+			first++;
+			continue;
+		}
+
+		batch.count = 0;
+		uint32_t i = first;
+		while (i < count)
+		{
+			const Packet& draw = m_Packets[m_Order[i].packet];
+			if (draw.view != packet.view || draw.shader != packet.shader || draw.material != packet.material || draw.vao != packet.vao)
+				break;
+			DrawCommand command = { draw.indexCount, 0, draw.firstIndex, draw.baseVertex, static_cast<GLuint>(m_Instances.size()) };
+			for (; i < count; i++)
+			{
+				const Packet& instance = m_Packets[m_Order[i].packet];
+				if (instance.vao != draw.vao || instance.firstIndex != draw.firstIndex || instance.indexCount != draw.indexCount ||
+					instance.baseVertex != draw.baseVertex || instance.view != draw.view || instance.shader != draw.shader ||
+					instance.material != draw.material)
+					break;
+				m_Instances.push_back(instance.model);
+				command.instanceCount++;
+			}
+			m_Commands.push_back(command);
+			batch.commandCount++;
+			batch.count += command.instanceCount;
+		}
+		m_Batches.push_back(batch);
+		first = i;
+	}
+}
+
+void RenderQueue::uploadInstances()
+{
+	if (m_Instances.empty())
+		return;
+	// orphaned every submit so the driver doesn't wait for last frame's draws. Never shrunk, a VAO
+	// keeps pointing at the offset of its last batch and that stays inside the buffer
+	m_InstanceCapacity = std::max(m_InstanceCapacity, m_Instances.size());
+	const GLsizeiptr bytes = static_cast<GLsizeiptr>(m_Instances.size() * sizeof(glm::mat4));
+	GLState::instance().bindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_InstanceCapacity * sizeof(glm::mat4)), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_Instances.data());
+
+	if (multiDraw())
+	{
+		const GLsizeiptr commandBytes = static_cast<GLsizeiptr>(m_Commands.size() * sizeof(DrawCommand));
+		GLState::instance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, m_Commands.data(), GL_STREAM_DRAW);
+	}
+}
+
+// points the bound VAO's instance attributes at the instance buffer from firstInstance on
+void RenderQueue::bindInstances(GLuint firstInstance)
+{
+	GLState::instance().bindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+	const size_t offset = size_t(firstInstance) * sizeof(glm::mat4);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(instanceLocation + column);
+		glVertexAttribPointer(instanceLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(instanceLocation + column, 1);
+	}
+}
+
+// least significant byte first, stable, so equal keys draw in the order they were queued. A byte
+// every key agrees on is skipped, with few programs and VAOs most of the high bytes are.
+void RenderQueue::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	scratch.resize(entries.size());
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (const SortEntry& entry : entries)
+			counts[(entry.key >> shift) & 0xFF]++;
+		if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+			continue;
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			const size_t next = offset + count;
+			count = offset;
+			offset = next;
+		}
+		for (const SortEntry& entry : entries)
+			scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+		entries.swap(scratch);
+	}
+}
+
+void RenderQueue::submit(FrameUniforms& frameUniforms)
+{
+	m_Stats = Stats();
+	if (m_Packets.empty())
+		return;
+
+	Timer timer;
+	radixSort(m_Order, m_Scratch);
+	m_Stats.sortMs = timer.elapsedMs();
+
+	buildBatches();
+	uploadInstances();
+
+	// what the previous batch left bound, 0xFFFFFFFF until something is. GLState still drops binds
+	// that match what the frame before left bound
+	const GLuint unknown = 0xFFFFFFFF;
+	GLuint program = unknown, vao = unknown;
+	uint32_t material = unknown;
+	int view = -1;
+	std::vector<GLuint> units;
+	const glm::mat4* model = nullptr;
+
+	for (const Batch& batch : m_Batches)
+	{
+		const Packet& packet = m_Packets[m_Order[batch.first].packet];
+		m_Stats.draws += batch.count;
+
+		m_Stats.views++;
+		if (packet.view != view)
+		{
+			frameUniforms.bind(packet.view);
+			view = packet.view;
+			m_Stats.viewsBound++;
+		}
+
+		m_Stats.programs++;
+		const Shader& shader = m_Shaders[packet.shader];
+		if (shader.ID != program)
+		{
+			shader.use();
+			program = shader.ID;
+			// samplers and the model matrix are program state
+			material = unknown;
+			model = nullptr;
+			m_Stats.programsBound++;
+		}
+
+		const MaterialEntry& entry = m_Materials[packet.material];
+		const std::vector<Material::Binding>& bindings = entry.material->bindings();
+		m_Stats.materials++;
+		m_Stats.textures += bindings.empty() ? 1 : bindings.size();
+		if (packet.material != material)
+		{
+			m_Stats.texturesBound += entry.material->bind(shader, units, entry.fallback);
+			material = packet.material;
+			m_Stats.materialsBound++;
+		}
+
+		m_Stats.vaos++;
+		if (packet.vao != vao)
+		{
+			GLState::instance().bindVertexArray(packet.vao);
+			vao = packet.vao;
+			m_Stats.vaosBound++;
+		}
+
+		if (batch.instanced)
+		{
+			const DrawCommand* commands = &m_Commands[batch.firstCommand];
+			m_Stats.commands += batch.commandCount;
+			m_Stats.instanced += batch.count;
+			if (multiDraw())
+			{
+				// the commands' base instance offsets into the buffer
+				bindInstances(0);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, packet.indexType, (void*)(size_t(batch.firstCommand) * sizeof(DrawCommand)), batch.commandCount, 0);
+				m_Stats.drawCalls++;
+				continue;
+			}
+			// GL 3.3 has no base instance, the instance attributes are pointed at every command instead
+			for (uint32_t i = 0; i < batch.commandCount; i++)
+			{
+				const DrawCommand& command = commands[i];
+				bindInstances(command.baseInstance);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, packet.indexType,
+					(void*)(size_t(command.firstIndex) * indexSize(packet.indexType)), command.instanceCount, command.baseVertex);
+			}
+			m_Stats.drawCalls += batch.commandCount;
+			continue;
+		}
+
+		m_Stats.models++;
+		if (!model || *model != packet.model)
+		{
+			shader.setMat4("model", packet.model);
+			model = &packet.model;
+			m_Stats.modelsUploaded++;
+		}
+
+		glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, packet.indexType, (void*)(size_t(packet.firstIndex) * indexSize(packet.indexType)), packet.baseVertex);
+		m_Stats.drawCalls++;
+	}
+}
+
+void RenderQueue::printStats() const
+{
+	const Stats& s = m_Stats;
+	std::printf("render queue: %zu draws sorted in %.3f ms, %zu draw calls (%zu draws instanced by %zu commands%s), bound %zu/%zu programs, %zu/%zu views, %zu/%zu materials, %zu/%zu textures, %zu/%zu VAOs, uploaded %zu/%zu model matrices, %zu state changes skipped\n",
+		s.draws, s.sortMs, s.drawCalls, s.instanced, s.commands, multiDraw() ? ", multi draw" : "", s.programsBound, s.programs, s.viewsBound, s.views, s.materialsBound, s.materials, s.texturesBound, s.textures,
+		s.vaosBound, s.vaos, s.modelsUploaded, s.models, s.skipped());
+}
@@ -0,0 +1,158 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FrameUniforms.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// The opaque draws of a frame, collected as packets instead of drawn where they are found. Each
+// packet gets a 64 bit key, most significant first:
+//
+//     view (4) | program (12) | material (16) | pool (4) | mesh (12) | level (4) | depth (12)
+//
+// so a radix sort groups the draws by the state that costs the most to change, and front to back
+// inside a group. submit() then only binds what differs from the previous packet. The key only
+// decides the order, the state itself is compared by GL name, so fields that don't fit their bits
+// cost some batching but never draw with the wrong state. A material change binds the bindings
+// the Material resolved at import and picks its constants' MaterialTable slot, nothing is looked up.
+//
+// Programs that read their model matrix from the aInstanceModel attribute (location 7 to 10, see
+// modelShaderInstanced.vert) are drawn instanced. Every run of packets that only differs in the
+// model matrix becomes one indirect command, the matrices streamed through an instance buffer once
+// per submit. Consecutive commands on the same state, the meshes of one GeometryPool, are then
+// issued by a single glMultiDrawElementsIndirect, or on GL 3.3 by a glDrawElementsInstancedBaseVertex
+// each. Other programs get the "model" uniform and a draw per packet.
+class RenderQueue
+{
+public:
+	// distances are quantized over this range, farther draws share the last step
+	static constexpr float maxDepth = 1000.0f;
+	// first location of the per instance model matrix, a mat4 takes four
+	static const GLuint instanceLocation = 7;
+
+	// creates and frees the instance and indirect command buffers
+	void setup();
+	void Delete();
+
+	// multi draw when the context has it (GL 4.3), false draws every command on its own
+	void setMultiDraw(bool enabled) { m_MultiDraw = enabled; }
+	bool multiDraw() const;
+
+	// forgets the last frame's packets
+	void clear();
+
+	// queues one level of a mesh drawn with material, which has to outlive the submit. texture is
+	// bound to unit 0 when the material has no textures of its own. depth is the distance from the camera
+	void add(const Shader& shader, FrameUniforms::View view, const Mesh& mesh, const Material& material, unsigned int lod, GLuint texture, const glm::mat4& model, float depth);
+
+	// sorts and draws everything queued, binding through GLState
+	void submit(FrameUniforms& frameUniforms);
+
+	size_t size() const { return m_Packets.size(); }
+
+	// what the last submit() asked for and what it had to bind
+	struct Stats
+	{
+		size_t draws = 0;         // packets
+		size_t drawCalls = 0;     // draw calls issued, a multi draw counts once
+		size_t commands = 0;      // indirect commands, one per mesh and level of an instanced program
+		size_t instanced = 0;     // packets drawn as an instance of a command
+		size_t programs = 0, programsBound = 0;
+		size_t views = 0, viewsBound = 0;
+		size_t materials = 0, materialsBound = 0;
+		size_t textures = 0, texturesBound = 0;
+		size_t vaos = 0, vaosBound = 0;
+		size_t models = 0, modelsUploaded = 0;  // packets of programs that aren't instanced
+		double sortMs = 0.0;
+
+		size_t skipped() const
+		{
+			return (programs - programsBound) + (views - viewsBound) + (materials - materialsBound) + (textures - texturesBound) + (vaos - vaosBound) + (models - modelsUploaded);
+		}
+	};
+	const Stats& stats() const { return m_Stats; }
+	void printStats() const;
+
+private:
+	// a material of this frame, with the texture bound in place of its own if it has none
+	struct MaterialEntry
+	{
+		const Material* material;
+		GLuint fallback;
+	};
+
+	struct Packet
+	{
+		uint32_t shader;  // in m_Shaders
+		FrameUniforms::View view;
+		uint32_t material;  // in m_Materials
+		GLuint vao;
+		GLenum indexType;
+		GLuint indexCount;
+		GLuint firstIndex;  // in the pool's element buffer
+		GLint baseVertex;
+		glm::mat4 model;
+	};
+
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	// the layout glMultiDrawElementsIndirect reads
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;  // in the instance buffer
+	};
+
+	// packets m_Order[first, first + count) drawn on the same state, by a model uniform and one draw
+	// or by the commands m_Commands[firstCommand, firstCommand + commandCount)
+	struct Batch
+	{
+		uint32_t first;
+		uint32_t count;
+		uint32_t firstCommand;
+		uint32_t commandCount;
+		bool instanced;
+	};
+
+	uint32_t internShader(const Shader& shader);
+	uint32_t internMaterial(const Material& material, GLuint texture);
+	uint32_t internMesh(const Mesh& mesh);
+	bool isInstanced(const Shader& shader);
+	void buildBatches();
+	void uploadInstances();
+	void bindInstances(GLuint firstInstance);
+	static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+	std::vector<Packet> m_Packets;
+	std::vector<SortEntry> m_Order, m_Scratch;
+	std::vector<Shader> m_Shaders;                           // copied once a frame, not per packet
+	std::unordered_map<GLuint, uint32_t> m_ShaderIndex;      // by program name
+	std::vector<MaterialEntry> m_Materials;
+	std::unordered_map<uint64_t, uint32_t> m_MaterialIndex;  // by table slot and fallback texture
+	std::unordered_map<uint64_t, uint32_t> m_MeshIndex;      // by pool and first index, numbered per frame
+	std::vector<Batch> m_Batches;
+	std::vector<glm::mat4> m_Instances;
+	std::vector<DrawCommand> m_Commands;
+	std::unordered_map<GLuint, bool> m_InstancedPrograms;  // by program name, found once
+	GLuint m_InstanceBuffer = 0, m_CommandBuffer = 0;
+	size_t m_InstanceCapacity = 0;  // matrices, the buffer never shrinks
+	bool m_MultiDraw = true;
+	Stats m_Stats;
+};
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "Renderer.h"
 
+#include <algorithm>
+
 
 
 
@@ -16,9 +18,9 @@ void Renderer::RenderText(Shader& shader, std::string text, float x, float y, fl
 {
     // activate corresponding render state	
     shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(UIVAO);
+    shader.setVec3("textColor", color);
+    GLState::instance().activeTexture(GL_TEXTURE0);
+    GLState::instance().bindVertexArray(UIVAO);
 
     // iterate through all characters
     std::string::const_iterator c;
@@ -42,40 +44,36 @@ void Renderer::RenderText(Shader& shader, std::string text, float x, float y, fl
             { xpos + w, ypos + h,   1.0f, 0.0f }
         };
         // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+        GLState::instance().bindTexture(GL_TEXTURE_2D, ch.TextureID);
         // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, UIVBO);
+        GLState::instance().bindBuffer(GL_ARRAY_BUFFER, UIVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
         // render quad
         glDrawArrays(GL_TRIANGLES, 0, 6);
         // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Renderer::renderCharacter(Model ourModel, Shader characterShader, unsigned int texture, Animator animator) {
+void Renderer::renderCharacter(Model& ourModel, Shader characterShader, unsigned int texture, const Animator& animator) {
 
 
     //activate shader
     characterShader.use();
 
     // bind rock map
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLState::instance().bindTexture2D(0, texture);
 
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.GetViewMatrix();
-    characterShader.setMat4("projection", projection);
-    characterShader.setMat4("view", view);
+    frameUniforms.bind(FrameUniforms::CameraNear);
 
-    // render the loaded model
-    auto transforms = animator.GetFinalBoneMatrices();
-    for (int i = 0; i < transforms.size(); ++i)
-        characterShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+    // the bones the skeleton has, into this instance's palette slot. The character is the frame's
+    // only skinned instance, so the palettes are uploaded right away
+    const auto& transforms = animator.GetFinalBoneMatrices();
+    const int bones = std::min(static_cast<int>(transforms.size()), ourModel.skeleton()->boneCount());
+    const int slot = bonePalette.write(transforms.data(), bones);
+    bonePalette.upload();
+    bonePalette.bind(slot);
 
 
     // render the loaded model
@@ -101,18 +99,11 @@ void Renderer::renderEnvironment(Shader lightingShader, unsigned int rockMap) {
     //activate shader
     lightingShader.use();
 
-    // create transformations
-    // pass projection matrix to shader (note that in this case it could change every frame)
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    lightingShader.setMat4("projection", projection);
-    lightingShader.setVec3("light.position", camera.Position + glm::vec3(0.0f, -1.0f, -4.0f));
-    // camera/view transformation
-    glm::mat4 view = camera.GetViewMatrix();
-    lightingShader.setMat4("view", view);
+    // projection, view and light come from the frame's uniform block
+    frameUniforms.bind(FrameUniforms::CameraNear);
 
     // bind rock map
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, rockMap);
+    GLState::instance().bindTexture2D(0, rockMap);
 
     // render boxes
     env_VAO.Bind();
@@ -139,7 +130,7 @@ void Renderer::renderHUD(Shader textShader, Shader hearthShader, unsigned int te
 
     
 
-    glDisable(GL_DEPTH_TEST);
+    GLState::instance().disable(GL_DEPTH_TEST);
 
 
     // render
@@ -152,14 +143,12 @@ void Renderer::renderHUD(Shader textShader, Shader hearthShader, unsigned int te
 
 
     // bind rock map
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLState::instance().bindTexture2D(0, texture);
 
     health_VAO.Bind();
     health_VBO.Bind();
 
-    glDisable(GL_BLEND);
-    glEnable(GL_BLEND);
+    GLState::instance().enable(GL_BLEND);
 
 
     // render hearths
@@ -187,7 +176,7 @@ void Renderer::renderHUD(Shader textShader, Shader hearthShader, unsigned int te
 
     }
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::instance().enable(GL_DEPTH_TEST);
 
 
 
@@ -202,7 +191,7 @@ void Renderer::renderHUD(Shader textShader, Shader hearthShader, unsigned int te
 void Renderer::renderHUDEntity(Entity& hearth, Shader textShader, Shader hearthShader, unsigned int texture) {
 
 
-    glDisable(GL_DEPTH_TEST);
+    GLState::instance().disable(GL_DEPTH_TEST);
 
 
     // render
@@ -215,8 +204,7 @@ void Renderer::renderHUDEntity(Entity& hearth, Shader textShader, Shader hearthS
 
 
     // bind rock map
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLState::instance().bindTexture2D(0, texture);
 
     health_VAO.Bind();
     health_VBO.Bind();
@@ -236,8 +224,7 @@ void Renderer::renderHUDEntity(Entity& hearth, Shader textShader, Shader hearthS
 
 
 
-    glDisable(GL_BLEND);
-    glEnable(GL_BLEND);
+    GLState::instance().enable(GL_BLEND);
 
     for (int i = 0; i < health; i++) {
 
@@ -254,7 +241,7 @@ void Renderer::renderHUDEntity(Entity& hearth, Shader textShader, Shader hearthS
 
     }
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::instance().enable(GL_DEPTH_TEST);
 
 
 
@@ -288,6 +275,28 @@ void Renderer::setupVAOVBO() {
 
     lightEnvironmentVAO.Bind();
 
+    frameUniforms.setup();
+    bonePalette.setup();
+    renderQueue.setup();
+
+}
+
+void Renderer::beginFrame() {
+
+    frameUniforms.update(camera, cameraSpy, (float)SCR_WIDTH / (float)SCR_HEIGHT);
+    bonePalette.beginFrame();
+    renderQueue.clear();
+}
+
+void Renderer::submitQueue() {
+
+    renderQueue.submit(frameUniforms);
+}
+
+void Renderer::queueModel(Model& model, const Shader& shader, FrameUniforms::View view, unsigned int texture, const glm::mat4& transform, unsigned int lod, float depth) {
+
+    for (const Mesh& mesh : model.meshes)
+        renderQueue.add(shader, view, mesh, model.materials[mesh.material], lod, texture, transform, depth);
 }
 
 void Renderer::deleteVAOVBO() {
@@ -302,6 +311,10 @@ void Renderer::deleteVAOVBO() {
 
     health_VAO.Delete();
     health_VBO.Delete();
+
+    frameUniforms.Delete();
+    bonePalette.Delete();
+    renderQueue.Delete();
 }
 
 
@@ -310,20 +323,10 @@ void Renderer::deleteVAOVBO() {
 
 void Renderer::renderEntity(Entity& ourEntity, Shader characterShader, unsigned int texture, const Frustum camFrustum, int select) {
 
-
-    //activate shader
-    characterShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // queued, drawn sorted by state in submitQueue
+    const float depth = glm::length(ourEntity.transform.getGlobalPosition() - camera.Position);
 
     if (select == 1) {
-        
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 1.0f, 1000.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        characterShader.setMat4("projection", projection);
-        characterShader.setMat4("view", view);
-
-
 
         // render the loaded model
         glm::mat4 model = glm::mat4(1.0f);
@@ -331,44 +334,25 @@ void Renderer::renderEntity(Entity& ourEntity, Shader characterShader, unsigned
         model = glm::scale(model, ourEntity.transform.getLocalScale());	// it's a bit too big for our scene, so scale it down
         float angle = 90.0f;
         model = glm::rotate(model, glm::radians(ourEntity.transform.getLocalRotation().y), ourEntity.transform.getLocalRotation());
-        characterShader.setMat4("model", model);
 
         if (ourEntity.boundingVolume->isOnFrustum(camFrustum, ourEntity.transform))
         {
-
-            ourEntity.pModel->Draw(characterShader);
-            
+            const unsigned int lod = ourEntity.selectLod(createLodViewFromCamera(camera, glm::radians(camera.Zoom), (float)SCR_HEIGHT));
+            queueModel(*ourEntity.pModel, characterShader, FrameUniforms::CameraFar, texture, model, lod, depth);
         }
     }
     else {
 
-        // create transformations
-        // pass projection matrix to shader (note that in this case it could change every frame)
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        characterShader.setMat4("projection", projection);
-        characterShader.setVec3("light.position", camera.Position + glm::vec3(0.0f, -1.0f, -4.0f));
-        // camera/view transformation
-        glm::mat4 view = camera.GetViewMatrix();
-        characterShader.setMat4("view", view);
-
-
-        // render boxes
-        env_VAO.Bind();
-
-
-
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, ourEntity.transform.getGlobalPosition());
         float angle = 0.0f;
         model = glm::scale(model, ourEntity.transform.getLocalScale());	// it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, glm::radians(ourEntity.transform.getLocalRotation().y), ourEntity.transform.getLocalRotation());
-        characterShader.setMat4("model", model);
 
         if (ourEntity.boundingVolume->isOnFrustum(camFrustum, ourEntity.transform))
         {
-
-            ourEntity.pModel->Draw(characterShader);
-            
+            const unsigned int lod = ourEntity.selectLod(createLodViewFromCamera(camera, glm::radians(camera.Zoom), (float)SCR_HEIGHT));
+            queueModel(*ourEntity.pModel, characterShader, FrameUniforms::CameraNear, texture, model, lod, depth);
         }
     }
     ourEntity.updateSelfAndChild();
@@ -379,25 +363,9 @@ void Renderer::renderEntity(Entity& ourEntity, Shader characterShader, unsigned
 void Renderer::renderSpyViewEntity(Entity& ourEntity, Shader characterShader, unsigned int texture, const Frustum camFrustum, int select) {
 
     if (select == 1) {
-        //activate shader
-        characterShader.use();
-
 
         if (ourEntity.boundingVolume->isOnFrustum(camFrustum, ourEntity.transform))
         {
-            //activate shader
-            characterShader.use();
-
-            // bind rock map
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            glm::mat4 projection = glm::perspective(glm::radians(cameraSpy.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 1.0f, 1000.0f);
-            glm::mat4 view = cameraSpy.GetViewMatrix();
-            characterShader.setMat4("projection", projection);
-            characterShader.setMat4("view", view);
-
-
 
             // render the loaded model
             glm::mat4 model = glm::mat4(1.0f);
@@ -405,8 +373,10 @@ void Renderer::renderSpyViewEntity(Entity& ourEntity, Shader characterShader, un
             model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));	// it's a bit too big for our scene, so scale it down
             float angle = 90.0f;
             model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 15.0f, 0.0f));
-            characterShader.setMat4("model", model);
-            ourEntity.pModel->Draw(characterShader);
+            // level picked for the spy camera and this draw's own placement, queued and drawn in submitQueue
+            const float depth = glm::length(glm::vec3(model[3]) - cameraSpy.Position);
+            const unsigned int lod = ourEntity.selectLod(createLodViewFromCamera(cameraSpy, glm::radians(cameraSpy.Zoom), (float)SCR_HEIGHT, 1), model);
+            queueModel(*ourEntity.pModel, characterShader, FrameUniforms::SpyFar, texture, model, lod, depth);
             ourEntity.updateSelfAndChild();
 
 
@@ -416,35 +386,16 @@ void Renderer::renderSpyViewEntity(Entity& ourEntity, Shader characterShader, un
         if (ourEntity.boundingVolume->isOnFrustum(camFrustum, ourEntity.transform))
         {
 
-            //activate shader
-            characterShader.use();
-
-            // create transformations
-            // pass projection matrix to shader (note that in this case it could change every frame)
-            glm::mat4 projection = glm::perspective(glm::radians(cameraSpy.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-            characterShader.setMat4("projection", projection);
-            characterShader.setVec3("light.position", camera.Position + glm::vec3(0.0f, -1.0f, -4.0f));
-            // camera/view transformation
-            glm::mat4 view = cameraSpy.GetViewMatrix();
-            characterShader.setMat4("view", view);
-
-            // bind rock map
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            // render boxes
-            env_VAO.Bind();
-
-
-
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0f, -20.0f, -80.0f));
             float angle = 0.0f;
             model = glm::scale(model, glm::vec3(0.3f, 0.3f, 0.3f));	// it's a bit too big for our scene, so scale it down
             model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 15.0f, 0.0f));
-            characterShader.setMat4("model", model);
 
-            ourEntity.pModel->Draw(characterShader);
+            // level picked for the spy camera and this draw's own placement, queued and drawn in submitQueue
+            const float depth = glm::length(glm::vec3(model[3]) - cameraSpy.Position);
+            const unsigned int lod = ourEntity.selectLod(createLodViewFromCamera(cameraSpy, glm::radians(cameraSpy.Zoom), (float)SCR_HEIGHT, 1), model);
+            queueModel(*ourEntity.pModel, characterShader, FrameUniforms::SpyNear, texture, model, lod, depth);
             ourEntity.updateSelfAndChild();
 
 
@@ -455,41 +406,10 @@ void Renderer::renderSpyViewEntity(Entity& ourEntity, Shader characterShader, un
 }
 
 
+// shares the texture with every Model that uses the same image, see TextureCache
 unsigned int Renderer::loadTexture(char const* path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureCache::instance().acquire(path);
 }
 
 
@@ -538,7 +458,7 @@ void Renderer::setupFreeType(Shader textShader)
             // generate texture
             unsigned int texture;
             glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
+            GLState::instance().bindTexture(GL_TEXTURE_2D, texture);
             glTexImage2D(
                 GL_TEXTURE_2D,
                 0,
@@ -564,7 +484,7 @@ void Renderer::setupFreeType(Shader textShader)
             };
             Characters.insert(std::pair<char, Character>(c, character));
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLState::instance().bindTexture(GL_TEXTURE_2D, 0);
     }
     // destroy FreeType once we're finished
     FT_Done_Face(face);
@@ -572,11 +492,11 @@ void Renderer::setupFreeType(Shader textShader)
 
 
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::instance().enable(GL_BLEND);
+    GLState::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
     textShader.use();
-    glUniformMatrix4fv(glGetUniformLocation(textShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    textShader.setMat4("projection", projection);
 
 
 
@@ -586,12 +506,12 @@ void Renderer::setupFreeType(Shader textShader)
     // -----------------------------------
     glGenVertexArrays(1, &UIVAO);
     glGenBuffers(1, &UIVBO);
-    glBindVertexArray(UIVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, UIVBO);
+    GLState::instance().bindVertexArray(UIVAO);
+    GLState::instance().bindBuffer(GL_ARRAY_BUFFER, UIVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::instance().bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::instance().bindVertexArray(0);
 
 }
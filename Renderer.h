@@ -11,7 +11,14 @@
 using namespace glm;
 
 #include "Animator.h"
-
+#include "BonePalette.h"
+#include "FrameUniforms.h"
+#include "GLState.h"
+#include "Model.h"
+#include "RenderQueue.h"
+
+#include "TextureCache.h"
+#include "TextureLoader.h"
 #include "VAO.h"
 #include "VBO.h"
 #include "Variables.cpp"
@@ -46,13 +53,19 @@ public:
 	Renderer();
 	unsigned int loadTexture(char const* path);
 	void RenderText(Shader& shader, std::string text, float x, float y, float scale, glm::vec3 color);
-	void renderCharacter(Model ourModel, Shader characterShader, unsigned int texture, Animator animator);
+	void renderCharacter(Model& ourModel, Shader characterShader, unsigned int texture, const Animator& animator);
 	void renderEnvironment(Shader lightingShader, unsigned int rockMap);
 	void renderHUD(Shader textShader, Shader hearthShader, unsigned int texture);
 	void renderHUDEntity(Entity& hearth, Shader textShader, Shader hearthShader, unsigned int texture);
 	void renderEntity(Entity& ourEntity, Shader characterShader, unsigned int texture, const Frustum camFrustum, int select);
 	void renderSpyViewEntity(Entity& ourEntity, Shader characterShader, unsigned int texture, const Frustum camFrustum, int select);
 	void setupFreeType(Shader textShader);
+	// uploads the camera and light of every view and empties the render queue, before the frame's first draw
+	void beginFrame();
+	// draws what renderEntity and renderSpyViewEntity queued, before anything drawn directly on top
+	void submitQueue();
+	// queues every mesh of the model at the level of detail
+	void queueModel(Model& model, const Shader& shader, FrameUniforms::View view, unsigned int texture, const glm::mat4& transform, unsigned int lod, float depth);
 	void setupVAOVBO();
 	void deleteVAOVBO();
 
@@ -69,6 +82,13 @@ public:
 	VAO health_VAO, env_VAO, char_VAO, lightEnvironmentVAO;
 	VBO health_VBO, env_VBO, char_VBO;
 
+	// camera and light blocks shared by the 3D programs, see FrameUniforms
+	FrameUniforms frameUniforms;
+	// final bone matrices of the skinned instances, see BonePalette
+	BonePalette bonePalette;
+	// the frame's entity draws, sorted by state, see RenderQueue
+	RenderQueue renderQueue;
+
 
 
 
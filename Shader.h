@@ -4,10 +4,13 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "UniformTable.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
 
 class Shader
 {
@@ -16,37 +19,49 @@ public:
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath);
+    // wraps a program from ShaderBuildQueue::submit(), it is checked on first use
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int program) : ID(program), m_Uniforms(std::make_shared<UniformTable>()) {}
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const;
+    // location of an active uniform, -1 if the program doesn't use it. Found in the table the
+    // program's uniforms were reflected into after linking, copies of the Shader share it.
+    // ------------------------------------------------------------------------
+    GLint uniformLocation(UniformName name) const;
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const;
+    void setBool(UniformName name, bool value) const;
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const;
+    void setInt(UniformName name, int value) const;
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const;
+    void setFloat(UniformName name, float value) const;
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const;
-    void setVec2(const std::string& name, float x, float y) const;
+    void setVec2(UniformName name, const glm::vec2& value) const;
+    void setVec2(UniformName name, float x, float y) const;
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const;
-    void setVec3(const std::string& name, float x, float y, float z) const;
+    void setVec3(UniformName name, const glm::vec3& value) const;
+    void setVec3(UniformName name, float x, float y, float z) const;
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const;
-    void setVec4(const std::string& name, float x, float y, float z, float w) const;
+    void setVec4(UniformName name, const glm::vec4& value) const;
+    void setVec4(UniformName name, float x, float y, float z, float w) const;
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const;
+    void setMat2(UniformName name, const glm::mat2& mat) const;
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const;
+    void setMat3(UniformName name, const glm::mat3& mat) const;
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
+    void setMat4(UniformName name, const glm::mat4& mat) const;
+    // count matrices from element 0 of an array uniform in one call
+    void setMat4Array(UniformName name, const glm::mat4* mats, GLsizei count) const;
     
 
 private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type);
-    
+    static void checkCompileErrors(GLuint shader, std::string type);
+    friend class ShaderBuildQueue;
+
+    std::shared_ptr<UniformTable> m_Uniforms;
+
 };
 #endif
\ No newline at end of file
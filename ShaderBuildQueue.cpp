@@ -0,0 +1,162 @@
+#include "ShaderBuildQueue.h"
+#include "BonePalette.h"
+#include "FrameUniforms.h"
+#include "Material.h"
+#include "Shader.h"
+#include "ShaderCache.h"
+#include "Timer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// from GL_KHR_parallel_shader_compile, which glad doesn't declare
+	typedef void (APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+	// GL_COMPLETION_STATUS_KHR and _ARB are the same enum
+	const GLenum COMPLETION_STATUS = 0x91B1;
+
+	std::string readSource(const char* path)
+	{
+		std::ifstream file;
+		// ensure ifstream objects can throw exceptions:
+		file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try
+		{
+			file.open(path);
+			std::stringstream stream;
+			stream << file.rdbuf();
+			return stream.str();
+		}
+		catch (std::ifstream::failure& e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+			return std::string();
+		}
+	}
+
+	// GLSL 3.30 can't give uniform blocks a binding, they're pointed at theirs once linked
+	void bindBlocks(GLuint program)
+	{
+		FrameUniforms::bindBlock(program);
+		BonePalette::bindBlock(program);
+		MaterialTable::bindBlock(program);
+	}
+}
+
+ShaderBuildQueue& ShaderBuildQueue::instance()
+{
+	static ShaderBuildQueue queue;
+	return queue;
+}
+
+ShaderBuildQueue::ShaderBuildQueue()
+{
+	// glad is generated without extensions, so the entry point comes from GLFW
+	MaxShaderCompilerThreads maxThreads = nullptr;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	if (maxThreads)
+	{
+		// as many threads as the driver wants to use
+		maxThreads(0xFFFFFFFF);
+		m_Parallel = true;
+	}
+}
+
+GLuint ShaderBuildQueue::submit(const char* vertexPath, const char* fragmentPath)
+{
+	std::string vertexCode = readSource(vertexPath);
+	std::string fragmentCode = readSource(fragmentPath);
+
+	// a program binary from an earlier run skips compiling and linking
+	if (GLuint program = ShaderCache::load(vertexCode, fragmentCode))
+	{
+		bindBlocks(program);
+		return program;
+	}
+
+	Timer timer;
+	const char* vShaderCode = vertexCode.c_str();
+	const char* fShaderCode = fragmentCode.c_str();
+	Build build;
+	build.vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+	glCompileShader(build.vertex);
+	build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+	glCompileShader(build.fragment);
+
+	// linking right away is fine, the driver waits for the stages on its side
+	GLuint program = glCreateProgram();
+	ShaderCache::prepare(program);
+	glAttachShader(program, build.vertex);
+	glAttachShader(program, build.fragment);
+	glLinkProgram(program);
+
+	build.vertexSource = std::move(vertexCode);
+	build.fragmentSource = std::move(fragmentCode);
+	build.submitMs = timer.elapsedMs();
+	m_Pending.emplace(program, std::move(build));
+	return program;
+}
+
+bool ShaderBuildQueue::completed(GLuint program) const
+{
+	if (m_Parallel)
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv(program, COMPLETION_STATUS, &done);
+		return done == GL_TRUE;
+	}
+	// without the extension any status query may block
+	return false;
+}
+
+void ShaderBuildQueue::poll()
+{
+	std::vector<GLuint> done;
+	for (const auto& it : m_Pending)
+	{
+		if (completed(it.first))
+			done.push_back(it.first);
+	}
+	for (GLuint program : done)
+		finishPending(program);
+}
+
+void ShaderBuildQueue::finishAll()
+{
+	while (!m_Pending.empty())
+		finishPending(m_Pending.begin()->first);
+}
+
+void ShaderBuildQueue::finishPending(GLuint program)
+{
+	auto it = m_Pending.find(program);
+	if (it == m_Pending.end())
+		return;
+	Build build = std::move(it->second);
+	m_Pending.erase(it);
+
+	// the first status query waits for the driver if it isn't done yet
+	Timer timer;
+	Shader::checkCompileErrors(build.vertex, "VERTEX");
+	Shader::checkCompileErrors(build.fragment, "FRAGMENT");
+	Shader::checkCompileErrors(program, "PROGRAM");
+	// delete the shaders as they're linked into our program now and no longer necessery
+	glDetachShader(program, build.vertex);
+	glDetachShader(program, build.fragment);
+	glDeleteShader(build.vertex);
+	glDeleteShader(build.fragment);
+	bindBlocks(program);
+
+	// the time this thread spent on the program, what a cache hit saves it next time
+	ShaderCache::save(program, build.vertexSource, build.fragmentSource, build.submitMs + timer.elapsedMs());
+}
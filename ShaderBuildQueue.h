@@ -0,0 +1,57 @@
+#ifndef SHADER_BUILD_QUEUE_H
+#define SHADER_BUILD_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+
+// Starts compiling and linking programs without waiting for the driver. submit() hands out the
+// program name right away and queries no status, so every program's sources reach the driver up
+// front and, with KHR/ARB_parallel_shader_compile, compile on its threads while the rest of
+// Game::init loads. A program is checked (compile and link logs, binary stored in the
+// ShaderCache) the first time it is used, or earlier by poll() once the driver reports it done.
+// Only call from the GL thread.
+class ShaderBuildQueue
+{
+public:
+	static ShaderBuildQueue& instance();
+
+	// a cached binary is loaded right away, anything else is compiled and linked in the background
+	GLuint submit(const char* vertexPath, const char* fragmentPath);
+
+	// checks the programs the driver has finished, never blocks. Only does something with parallel compile.
+	void poll();
+
+	// blocks until the program is linked and checks it, nothing to do for programs that are already checked
+	void finish(GLuint program)
+	{
+		if (!m_Pending.empty())
+			finishPending(program);
+	}
+
+	void finishAll();
+
+	size_t pendingCount() const { return m_Pending.size(); }
+	bool parallel() const { return m_Parallel; }
+
+private:
+	struct Build
+	{
+		GLuint vertex;
+		GLuint fragment;
+		std::string vertexSource;
+		std::string fragmentSource;
+		double submitMs;  // spent in submit(), the driver may compile in there as well
+	};
+
+	ShaderBuildQueue();
+
+	void finishPending(GLuint program);
+	bool completed(GLuint program) const;
+
+	std::unordered_map<GLuint, Build> m_Pending;
+	bool m_Parallel = false;
+};
+
+#endif
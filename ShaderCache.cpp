@@ -0,0 +1,217 @@
+#include "ShaderCache.h"
+#include "Timer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+ShaderCache::Stats ShaderCache::s_Stats;
+
+namespace
+{
+	const char cacheMagic[4] = { 'C', 'P', 'R', 'G' };
+	const char* cacheDirectory = "shadercache";
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t driverHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+		double compileMs;
+	};
+
+	// FNV-1a, only used to tell sources and drivers apart, not for security
+	uint64_t hashString(const char* text, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(text[i]);
+			hash *= 0x100000001b3ull;
+		}
+		// the terminator keeps "ab" + "c" apart from "a" + "bc"
+		hash ^= 0xff;
+		hash *= 0x100000001b3ull;
+		return hash;
+	}
+}
+
+bool ShaderCache::supported()
+{
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+	static const bool available = [] {
+		// the extension flag only exists when glad was generated with it, 4.1 has the calls in core
+		bool binaries = GLAD_GL_VERSION_4_1 != 0;
+#ifdef GL_ARB_get_program_binary
+		binaries = binaries || GLAD_GL_ARB_get_program_binary;
+#endif
+		if (!binaries)
+			return false;
+		// the extension can be exposed with no formats, then there is nothing to store
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}();
+	return available;
+#else
+	return false;
+#endif
+}
+
+uint64_t ShaderCache::sourceHash(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	return hashString(fragmentSource.data(), fragmentSource.size(), hashString(vertexSource.data(), vertexSource.size()));
+}
+
+uint64_t ShaderCache::driverHash()
+{
+	// binaries are only valid for the driver build that produced them
+	static const uint64_t hash = [] {
+		uint64_t result = 0xcbf29ce484222325ull;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const char* text = reinterpret_cast<const char*>(glGetString(name));
+			result = hashString(text ? text : "", text ? std::strlen(text) : 0, result);
+		}
+		return result;
+	}();
+	return hash;
+}
+
+std::string ShaderCache::cachePathFor(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	// the driver is part of the name, so machines or GPUs sharing a checkout don't evict each other
+	char name[64];
+	std::snprintf(name, sizeof(name), "%016llx.progbin",
+		static_cast<unsigned long long>(sourceHash(vertexSource, fragmentSource) ^ (driverHash() * 31)));
+	return std::string(cacheDirectory) + "/" + name;
+}
+
+GLuint ShaderCache::load(const std::string& vertexSource, const std::string& fragmentSource)
+{
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+	if (!supported())
+	{
+		s_Stats.misses++;
+		return 0;
+	}
+
+	Timer timer;
+	std::ifstream file(cachePathFor(vertexSource, fragmentSource), std::ios::binary);
+	CacheHeader header;
+	if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0
+		|| header.version != version
+		|| header.sourceHash != sourceHash(vertexSource, fragmentSource)
+		|| header.driverHash != driverHash())
+	{
+		s_Stats.misses++;
+		return 0;
+	}
+
+	std::vector<char> binary(header.binarySize);
+	if (!file.read(binary.data(), binary.size()))
+	{
+		s_Stats.misses++;
+		return 0;
+	}
+
+	// the driver may still refuse it, e.g. after an update that kept its version string
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		glDeleteProgram(program);
+		s_Stats.rejected++;
+		s_Stats.misses++;
+		return 0;
+	}
+
+	const double loadMs = timer.elapsedMs();
+	s_Stats.hits++;
+	s_Stats.loadMs += loadMs;
+	s_Stats.savedMs += header.compileMs - loadMs;
+	return program;
+#else
+	s_Stats.misses++;
+	return 0;
+#endif
+}
+
+void ShaderCache::prepare(GLuint program)
+{
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+	if (supported())
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+}
+
+bool ShaderCache::save(GLuint program, const std::string& vertexSource, const std::string& fragmentSource, double compileMs)
+{
+	s_Stats.compileMs += compileMs;
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+	if (!supported())
+		return false;
+
+	GLint linked = GL_FALSE, length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!linked || length <= 0)
+		return false;
+
+	CacheHeader header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = version;
+	header.sourceHash = sourceHash(vertexSource, fragmentSource);
+	header.driverHash = driverHash();
+	header.compileMs = compileMs;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.binaryFormat = format;
+	header.binarySize = static_cast<uint32_t>(length);
+
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDirectory, ec);
+
+	// write to a temporary file first so a crash never leaves a torn cache behind
+	const std::string cachePath = cachePathFor(vertexSource, fragmentSource);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(binary.data(), header.binarySize);
+		if (!out)
+		{
+			std::cout << "ERROR::SHADERCACHE:: could not write " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::cout << "ERROR::SHADERCACHE:: could not replace " << cachePath << ": " << ec.message() << std::endl;
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ShaderCache::printStats()
+{
+	std::printf("shader cache: %u hits (%.1f ms), %u misses (%.1f ms compiling), %u rejected, %.1f ms of compiling saved%s\n",
+		s_Stats.hits, s_Stats.loadMs, s_Stats.misses, s_Stats.compileMs, s_Stats.rejected, s_Stats.savedMs,
+		supported() ? "" : ", program binaries not supported");
+}
@@ -0,0 +1,54 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+// Cache of linked program binaries (glGetProgramBinary) in "shadercache/". A program is found by
+// a hash of its sources and of the driver's vendor, renderer and version strings, so editing a
+// shader or updating the driver simply misses. A binary the driver rejects anyway is recompiled
+// and overwritten. Without ARB_get_program_binary or any binary format every lookup misses and
+// Shader compiles as before. Only call from the GL thread.
+class ShaderCache
+{
+public:
+	// bump whenever the layout of the file changes
+	static const unsigned int version = 1;
+
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int rejected = 0;  // found, but the driver refused the binary
+		double loadMs = 0.0;        // glProgramBinary of the hits
+		double compileMs = 0.0;     // compiling and linking the misses
+		double savedMs = 0.0;       // what the hits took to compile when they were cached, minus loadMs
+	};
+
+	static bool supported();
+
+	// a linked program, or 0 if there is no usable binary
+	static GLuint load(const std::string& vertexSource, const std::string& fragmentSource);
+
+	// call before linking, so the driver keeps a binary it can hand out
+	static void prepare(GLuint program);
+
+	// stores the binary of a linked program, compileMs is reported as saved by later hits
+	static bool save(GLuint program, const std::string& vertexSource, const std::string& fragmentSource, double compileMs);
+
+	static std::string cachePathFor(const std::string& vertexSource, const std::string& fragmentSource);
+
+	static const Stats& stats() { return s_Stats; }
+	static void resetStats() { s_Stats = Stats(); }
+	static void printStats();
+
+private:
+	static uint64_t sourceHash(const std::string& vertexSource, const std::string& fragmentSource);
+	static uint64_t driverHash();
+
+	static Stats s_Stats;
+};
+
+#endif
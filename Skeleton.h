@@ -0,0 +1,89 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <glm/glm.hpp>
+#include <assimp/scene.h>
+
+#include "AnimData.h"
+#include "glm_helper.h"
+
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct AssimpNodeData
+{
+	glm::mat4 transformation;
+	std::string name;
+	int childrenCount;
+	std::vector<AssimpNodeData> children;
+};
+
+// The bones of a model and the node hierarchy its clips animate, shared by the Model and every
+// Animation played on it, so clips from separate files all use the same bone ids.
+// Bones and the hierarchy are only added while loading, which may happen on several pool
+// threads at once; reading them is for the GL thread once loading is done.
+class Skeleton
+{
+public:
+	Skeleton() = default;
+	Skeleton(std::map<std::string, BoneInfo> bones, int boneCount) : m_Bones(std::move(bones)), m_BoneCount(boneCount) {}
+
+	// id of the named bone. Bones no mesh is weighted to, only moved by a clip, are added with an
+	// identity offset.
+	int addBone(const std::string& name, const glm::mat4& offset = glm::mat4(1.0f))
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto inserted = m_Bones.emplace(name, BoneInfo{ m_BoneCount, offset });
+		if (inserted.second)
+			m_BoneCount++;
+		return inserted.first->second.id;
+	}
+
+	// nullptr if the node isn't a bone
+	const BoneInfo* findBone(const std::string& name) const
+	{
+		auto it = m_Bones.find(name);
+		return it == m_Bones.end() ? nullptr : &it->second;
+	}
+
+	const std::map<std::string, BoneInfo>& bones() const { return m_Bones; }
+	int boneCount() const { return m_BoneCount; }
+
+	// the hierarchy comes from the first scene with a clip, later clips animate the same nodes by name
+	void readHierarchy(const aiNode* root)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_HasHierarchy)
+			return;
+		ReadHeirarchyData(m_RootNode, root);
+		m_HasHierarchy = true;
+	}
+
+	bool hasHierarchy() const { return m_HasHierarchy; }
+	const AssimpNodeData& rootNode() const { return m_RootNode; }
+
+private:
+	static void ReadHeirarchyData(AssimpNodeData& dest, const aiNode* src)
+	{
+		assert(src);
+
+		dest.name = src->mName.data;
+		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
+		dest.childrenCount = src->mNumChildren;
+
+		dest.children.resize(src->mNumChildren);
+		for (int i = 0; i < src->mNumChildren; i++)
+			ReadHeirarchyData(dest.children[i], src->mChildren[i]);
+	}
+
+	std::map<std::string, BoneInfo> m_Bones;
+	int m_BoneCount = 0;
+	AssimpNodeData m_RootNode;
+	bool m_HasHierarchy = false;
+	std::mutex m_Mutex;
+};
+
+#endif
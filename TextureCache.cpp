@@ -0,0 +1,166 @@
+#include "TextureCache.h"
+#include "GLState.h"
+#include "TextureCooker.h"
+#include "TextureLoader.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	// FNV-1a, only used to find identical files, not for security
+	uint64_t hashBytes(const std::vector<unsigned char>& bytes)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (unsigned char byte : bytes)
+		{
+			hash ^= byte;
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !bytes.empty();
+	}
+}
+
+TextureCache& TextureCache::instance()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+std::string TextureCache::canonicalPath(const std::string& path)
+{
+	std::error_code ec;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+	if (ec)
+		return std::filesystem::path(path).lexically_normal().generic_string();
+	return canonical.generic_string();
+}
+
+unsigned int TextureCache::acquire(const std::string& path)
+{
+	const std::string canonical = canonicalPath(path);
+
+	auto byPath = m_ByPath.find(canonical);
+	if (byPath != m_ByPath.end())
+	{
+		m_Entries[byPath->second].refCount++;
+		m_Stats.pathHits++;
+		return byPath->second;
+	}
+
+	// a cooked container next to the source replaces it, it carries compressed mips ready to upload.
+	// Without S3TC in the driver the source image is decoded instead
+	const bool cooked = TextureLoader::compressedSupported() && TextureCooker::isCookedCurrent(canonical);
+	const std::string source = cooked ? TextureCooker::cookedPathFor(canonical) : canonical;
+
+	// unknown path, the contents may still be resident under another name, but only if a resident
+	// file has the same size. Just then the files are read and hashed here, on the GL thread
+	std::error_code ec;
+	const uint64_t size = std::filesystem::file_size(source, ec);
+	std::vector<unsigned char> bytes;
+	uint64_t hash = 0;
+	bool hashed = false;
+	if (!ec)
+	{
+		auto candidates = m_BySize.equal_range(size);
+		if (candidates.first != candidates.second && readFile(source, bytes))
+		{
+			hash = hashBytes(bytes);
+			hashed = true;
+		}
+		for (auto it = candidates.first; hashed && it != candidates.second; ++it)
+		{
+			Entry& entry = m_Entries[it->second];
+			if (!contentHash(entry) || entry.hash != hash)
+				continue;
+			entry.refCount++;
+			entry.paths.push_back(canonical);
+			m_ByPath[canonical] = it->second;
+			m_Stats.contentHits++;
+			return it->second;
+		}
+	}
+
+	// the loader decodes from the bytes if they were read, otherwise its worker reads the file
+	unsigned int textureID = TextureLoader::instance().load(source, std::move(bytes));
+	Entry& entry = m_Entries[textureID];
+	entry.refCount = 1;
+	entry.source = source;
+	entry.sized = !ec;
+	entry.size = size;
+	entry.hashed = hashed;
+	entry.hash = hash;
+	entry.paths.push_back(canonical);
+	m_ByPath[canonical] = textureID;
+	if (!ec)
+		m_BySize.emplace(size, textureID);
+	m_Stats.misses++;
+	return textureID;
+}
+
+bool TextureCache::contentHash(Entry& entry)
+{
+	if (!entry.hashed)
+	{
+		std::vector<unsigned char> bytes;
+		if (!readFile(entry.source, bytes))
+			return false;
+		entry.hash = hashBytes(bytes);
+		entry.hashed = true;
+	}
+	return true;
+}
+
+void TextureCache::eraseBySize(unsigned int textureID, uint64_t size)
+{
+	auto range = m_BySize.equal_range(size);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == textureID)
+		{
+			m_BySize.erase(it);
+			return;
+		}
+	}
+}
+
+unsigned int TextureCache::refCount(unsigned int textureID) const
+{
+	auto it = m_Entries.find(textureID);
+	return it == m_Entries.end() ? 0 : it->second.refCount;
+}
+
+void TextureCache::release(unsigned int textureID)
+{
+	auto it = m_Entries.find(textureID);
+	if (it == m_Entries.end() || --it->second.refCount > 0)
+		return;
+
+	for (const std::string& path : it->second.paths)
+		m_ByPath.erase(path);
+	if (it->second.sized)
+		eraseBySize(textureID, it->second.size);
+	m_Entries.erase(it);
+
+	TextureLoader::instance().cancel(textureID);
+	GLState::instance().deleteTexture(textureID);
+	m_Stats.released++;
+}
+
+void TextureCache::printStats() const
+{
+	const unsigned int lookups = m_Stats.pathHits + m_Stats.contentHits + m_Stats.misses;
+	std::printf("texture cache: %u lookups, %u path hits, %u content hits, %u misses, %zu resident, %u released\n",
+		lookups, m_Stats.pathHits, m_Stats.contentHits, m_Stats.misses, m_Entries.size(), m_Stats.released);
+}
@@ -0,0 +1,65 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process wide registry of loaded textures, shared by every Model and the Renderer.
+// Lookups go by canonical path first and then by file contents, so the same image is decoded
+// and resident exactly once no matter how many paths or owners refer to it. Contents are only
+// compared when a resident texture has a file of the same size; otherwise nothing is read on
+// the GL thread and the loader's worker reads the file.
+// When TextureCooker has produced an up to date .ktx for a path, that file is loaded instead.
+// Each acquire() must be paired with a release(); the texture is deleted with its last reference.
+// Only call from the GL thread.
+class TextureCache
+{
+public:
+	struct Stats
+	{
+		unsigned int pathHits = 0;     // resolved by canonical path
+		unsigned int contentHits = 0;  // new path, but identical file contents already resident
+		unsigned int misses = 0;       // had to be loaded
+		unsigned int released = 0;     // deleted after their last reference went away
+	};
+
+	static TextureCache& instance();
+
+	unsigned int acquire(const std::string& path);
+	void release(unsigned int textureID);
+	// references held on the texture, 0 if it isn't in the cache
+	unsigned int refCount(unsigned int textureID) const;
+
+	size_t residentCount() const { return m_Entries.size(); }
+	const Stats& stats() const { return m_Stats; }
+	void printStats() const;
+
+private:
+	TextureCache() = default;
+
+	struct Entry
+	{
+		unsigned int refCount = 0;
+		std::string source;              // the file that was loaded, the source image or its .ktx
+		bool sized = false;              // listed in m_BySize under size
+		uint64_t size = 0;
+		bool hashed = false;             // hash is computed the first time another file has the same size
+		uint64_t hash = 0;
+		std::vector<std::string> paths;  // canonical paths that resolve to this texture
+	};
+
+	// the FNV-1a hash of the entry's file, read now if it wasn't needed before
+	bool contentHash(Entry& entry);
+	void eraseBySize(unsigned int textureID, uint64_t size);
+
+	static std::string canonicalPath(const std::string& path);
+
+	std::unordered_map<std::string, unsigned int> m_ByPath;
+	std::unordered_multimap<uint64_t, unsigned int> m_BySize;  // file size to the textures loaded from such a file
+	std::unordered_map<unsigned int, Entry> m_Entries;
+	Stats m_Stats;
+};
+
+#endif
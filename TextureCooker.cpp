@@ -0,0 +1,349 @@
+#include "TextureCooker.h"
+#include "KtxTexture.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	struct CookResult
+	{
+		int width = 0;
+		int height = 0;
+		bool alpha = false;
+		size_t levels = 0;
+		size_t uncompressedBytes = 0;  // what the runtime path used to keep on the GPU, mips included
+		size_t cookedBytes = 0;
+		double ms = 0.0;
+		bool ok = false;
+	};
+
+	// 2x2 box filter, odd edges repeat the last texel
+	std::vector<unsigned char> downsample(const std::vector<unsigned char>& src, int width, int height, int& outWidth, int& outHeight)
+	{
+		outWidth = std::max(1, width / 2);
+		outHeight = std::max(1, height / 2);
+		std::vector<unsigned char> dst(size_t(outWidth) * outHeight * 4);
+		for (int y = 0; y < outHeight; y++)
+		{
+			const int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+			for (int x = 0; x < outWidth; x++)
+			{
+				const int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = src[(size_t(y0) * width + x0) * 4 + c] + src[(size_t(y0) * width + x1) * 4 + c]
+						+ src[(size_t(y1) * width + x0) * 4 + c] + src[(size_t(y1) * width + x1) * 4 + c];
+					dst[(size_t(y) * outWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		return dst;
+	}
+
+	uint16_t packRgb565(const float color[3])
+	{
+		int r = std::clamp(int(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = std::clamp(int(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = std::clamp(int(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC1 color block: endpoints on the principal axis of the 16 colors, inset a little to
+	// reduce the error at the extremes, every texel gets the nearest of the four palette entries
+	void encodeColorBlock(const unsigned char block[16][4], unsigned char* out)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 3; c++)
+				mean[c] += block[i][c] / 16.0f;
+
+		float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+			cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+			cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+		}
+
+		// a few power iterations are plenty for a 3x3 matrix
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float next[3] = {
+				cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+				cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+				cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+			};
+			float largest = std::max({ std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2]) });
+			if (largest == 0.0f)
+				break;
+			for (int c = 0; c < 3; c++)
+				axis[c] = next[c] / largest;
+		}
+		float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (int c = 0; c < 3; c++)
+			axis[c] /= length;
+
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		const float inset = (maxT - minT) / 16.0f;
+		minT += inset;
+		maxT -= inset;
+
+		float high[3], low[3];
+		for (int c = 0; c < 3; c++)
+		{
+			high[c] = mean[c] + axis[c] * maxT;
+			low[c] = mean[c] + axis[c] * minT;
+		}
+		uint16_t color0 = packRgb565(high), color1 = packRgb565(low);
+		// color0 > color1 selects the four color mode, BC3 only has that one
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			unpackRgb565(color0, palette[0]);
+			unpackRgb565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = INT32_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= uint32_t(best) << (2 * i);
+			}
+		}
+
+		std::memcpy(out, &color0, 2);
+		std::memcpy(out + 2, &color1, 2);
+		std::memcpy(out + 4, &indices, 4);
+	}
+
+	// BC3 alpha block in the eight value mode: alpha0 = max > alpha1 = min, six interpolated steps
+	void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out)
+	{
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, int(block[i][3]));
+			alpha1 = std::min(alpha1, int(block[i][3]));
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			int palette[8] = { alpha0, alpha1 };
+			for (int p = 2; p < 8; p++)
+				palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int error = std::abs(block[i][3] - palette[p]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= uint64_t(best) << (3 * i);
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(alpha0);
+		out[1] = static_cast<unsigned char>(alpha1);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+	}
+
+	void encodeLevel(const std::vector<unsigned char>& rgba, int width, int height, bool alpha, std::vector<unsigned char>& out)
+	{
+		const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const size_t blockSize = alpha ? 16 : 8;
+		const size_t start = out.size();
+		out.resize(start + size_t(blocksX) * blocksY * blockSize);
+
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				// blocks hanging over the edge of small mips repeat the last row and column
+				unsigned char block[16][4];
+				for (int y = 0; y < 4; y++)
+				{
+					const int sy = std::min(by * 4 + y, height - 1);
+					for (int x = 0; x < 4; x++)
+					{
+						const int sx = std::min(bx * 4 + x, width - 1);
+						std::memcpy(block[y * 4 + x], &rgba[(size_t(sy) * width + sx) * 4], 4);
+					}
+				}
+
+				unsigned char* dst = &out[start + (size_t(by) * blocksX + bx) * blockSize];
+				if (alpha)
+				{
+					encodeAlphaBlock(block, dst);
+					encodeColorBlock(block, dst + 8);
+				}
+				else
+					encodeColorBlock(block, dst);
+			}
+		}
+	}
+
+	CookResult cookFile(const std::string& source)
+	{
+		CookResult result;
+		Timer timer;
+
+		int width, height, components;
+		unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &components, 4);
+		if (!pixels)
+		{
+			std::cout << "ERROR::TEXTURE_COOKER:: could not load " << source << std::endl;
+			return result;
+		}
+		std::vector<unsigned char> level(pixels, pixels + size_t(width) * height * 4);
+		stbi_image_free(pixels);
+
+		bool alpha = false;
+		if (components == 2 || components == 4)
+			for (size_t i = 3; i < level.size() && !alpha; i += 4)
+				alpha = level[i] != 255;
+
+		KtxTexture ktx;
+		ktx.internalFormat = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		ktx.baseInternalFormat = alpha ? GL_RGBA : GL_RGB;
+		ktx.width = width;
+		ktx.height = height;
+
+		result.width = width;
+		result.height = height;
+		result.alpha = alpha;
+
+		int levelWidth = width, levelHeight = height;
+		for (;;)
+		{
+			size_t offset = ktx.data.size();
+			encodeLevel(level, levelWidth, levelHeight, alpha, ktx.data);
+			ktx.levels.push_back({ uint32_t(levelWidth), uint32_t(levelHeight), offset, ktx.data.size() - offset });
+			result.uncompressedBytes += size_t(levelWidth) * levelHeight * components;
+
+			if (levelWidth == 1 && levelHeight == 1)
+				break;
+			level = downsample(level, levelWidth, levelHeight, levelWidth, levelHeight);
+		}
+
+		if (!ktx.write(TextureCooker::cookedPathFor(source)))
+		{
+			std::cout << "ERROR::TEXTURE_COOKER:: could not write " << TextureCooker::cookedPathFor(source) << std::endl;
+			return result;
+		}
+
+		result.levels = ktx.levels.size();
+		result.cookedBytes = ktx.byteSize();
+		result.ms = timer.elapsedMs();
+		result.ok = true;
+		return result;
+	}
+}
+
+const std::vector<std::string>& TextureCooker::defaultSources()
+{
+	static const std::vector<std::string> sources = {
+		"wall.jpg", "rock.jpg", "_Carrera_Marble_1.jpg", "hearth.jpg", "bird/txtr01.jpg", "bird/txtr02.jpg",
+	};
+	return sources;
+}
+
+int TextureCooker::run(const std::vector<std::string>& sources)
+{
+	const std::vector<std::string>& files = sources.empty() ? defaultSources() : sources;
+
+	// same orientation as the runtime path gets from Game::init
+	stbi_set_flip_vertically_on_load(true);
+
+	std::vector<CookResult> results(files.size());
+	ThreadPool::shared().parallelFor(files.size(), [&](size_t i)
+	{
+		results[i] = cookFile(files[i]);
+	});
+
+	std::printf("%-24s %11s %4s %7s %12s %12s %7s %10s\n", "texture", "size", "fmt", "levels", "raw KB", "cooked KB", "ratio", "ms");
+	int failures = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const CookResult& result = results[i];
+		if (!result.ok)
+		{
+			std::printf("%-24s %11s\n", files[i].c_str(), "failed");
+			failures++;
+			continue;
+		}
+		std::printf("%-24s %5dx%-5d %4s %7zu %12.1f %12.1f %6.1fx %10.2f\n", files[i].c_str(), result.width, result.height,
+			result.alpha ? "BC3" : "BC1", result.levels, result.uncompressedBytes / 1024.0, result.cookedBytes / 1024.0,
+			double(result.uncompressedBytes) / result.cookedBytes, result.ms);
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+bool TextureCooker::cook(const std::string& source)
+{
+	return cookFile(source).ok;
+}
+
+std::string TextureCooker::cookedPathFor(const std::string& source)
+{
+	return std::filesystem::path(source).replace_extension(".ktx").string();
+}
+
+bool TextureCooker::isCookedCurrent(const std::string& source)
+{
+	std::error_code ec;
+	auto cookedTime = std::filesystem::last_write_time(cookedPathFor(source), ec);
+	if (ec)
+		return false;
+	auto sourceTime = std::filesystem::last_write_time(source, ec);
+	// a cooked file without its source is still usable
+	return ec || cookedTime >= sourceTime;
+}
@@ -0,0 +1,28 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include <string>
+#include <vector>
+
+// Offline conversion of source images into KtxTexture containers holding the whole mip chain
+// already block compressed, BC1 for opaque images and BC3 when there is alpha. The cooked file
+// sits next to the source (wall.jpg -> wall.ktx) and TextureCache picks it up instead of the
+// source as long as it is not older. Runs without a GL context.
+class TextureCooker
+{
+public:
+	// the textures the game loads, cooked when no files are named on the command line
+	static const std::vector<std::string>& defaultSources();
+
+	// "--cook [files...]"
+	static int run(const std::vector<std::string>& sources);
+
+	static bool cook(const std::string& source);
+
+	static std::string cookedPathFor(const std::string& source);
+
+	// true if the cooked file exists and was written after the source was last changed
+	static bool isCookedCurrent(const std::string& source);
+};
+
+#endif
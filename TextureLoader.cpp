@@ -0,0 +1,314 @@
+#include "TextureLoader.h"
+#include "GLState.h"
+#include "ThreadPool.h"
+
+#include "stb_image.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+TextureLoader& TextureLoader::instance()
+{
+	static TextureLoader loader;
+	return loader;
+}
+
+bool TextureLoader::compressedSupported()
+{
+	// S3TC is an extension even in GL 4.6, glad is generated without extensions
+	static const bool supported = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") != 0;
+	return supported;
+}
+
+TextureLoader::~TextureLoader()
+{
+	// decode tasks still running on the pool write into this object
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Decoded.wait(lock, [this] { return m_Decoding == 0; });
+	for (DecodedImage& image : m_Ready)
+		stbi_image_free(image.pixels);
+}
+
+unsigned int TextureLoader::load(const std::string& path, std::vector<unsigned char> encoded)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	setPlaceholder(textureID);
+
+	TextureTiming timing;
+	timing.path = path;
+	timing.textureID = textureID;
+	m_Timings.push_back(timing);
+	size_t timingIndex = m_Timings.size() - 1;
+	m_Pending[textureID] = timingIndex;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Decoding++;
+	}
+	Timer::Clock::time_point requested = Timer::Clock::now();
+	ThreadPool::shared().submit([this, textureID, timingIndex, path, encoded = std::move(encoded), requested]
+	{
+		decode(textureID, timingIndex, path, encoded, requested);
+	});
+
+	return textureID;
+}
+
+void TextureLoader::cancel(unsigned int textureID)
+{
+	// by load rather than by name, a name deleted now can come back from the next load
+	auto it = m_Pending.find(textureID);
+	if (it == m_Pending.end())
+		return;
+	m_Cancelled.insert(it->second);
+	m_Pending.erase(it);
+}
+
+void TextureLoader::decode(unsigned int textureID, size_t timingIndex, const std::string& path, const std::vector<unsigned char>& encoded, Timer::Clock::time_point requested)
+{
+	Timer timer;
+	DecodedImage image;
+	image.textureID = textureID;
+	image.timingIndex = timingIndex;
+	image.requested = requested;
+	image.pixels = nullptr;
+	if (KtxTexture::isKtx(encoded.data(), encoded.size()))
+	{
+		image.compressed.reset(new KtxTexture);
+		if (!image.compressed->parse(encoded.data(), encoded.size()))
+			image.compressed.reset();
+	}
+	else if (encoded.empty())
+		image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+	else
+		image.pixels = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()), &image.width, &image.height, &image.components, 0);
+	image.decodeMs = timer.elapsedMs();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Ready.push_back(std::move(image));
+		m_Decoding--;
+	}
+	m_Decoded.notify_all();
+}
+
+void TextureLoader::processUploads(unsigned int maxUploads)
+{
+	for (unsigned int i = 0; i < maxUploads; i++)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Ready.empty())
+				return;
+			image = std::move(m_Ready.front());
+			m_Ready.pop_front();
+		}
+		upload(image);
+	}
+}
+
+void TextureLoader::finish()
+{
+	for (;;)
+	{
+		processUploads(~0u);
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_Decoding == 0 && m_Ready.empty())
+			return;
+		m_Decoded.wait(lock, [this] { return !m_Ready.empty() || m_Decoding == 0; });
+	}
+}
+
+bool TextureLoader::idle()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Decoding == 0 && m_Ready.empty();
+}
+
+void TextureLoader::upload(DecodedImage& image)
+{
+	TextureTiming& timing = m_Timings[image.timingIndex];
+	timing.decodeMs = image.decodeMs;
+
+	auto pending = m_Pending.find(image.textureID);
+	if (pending != m_Pending.end() && pending->second == image.timingIndex)
+		m_Pending.erase(pending);
+	if (m_Cancelled.erase(image.timingIndex))
+	{
+		stbi_image_free(image.pixels);
+		timing.failed = true;
+		return;
+	}
+
+	if (image.compressed)
+	{
+		if (compressedSupported())
+		{
+			uploadCompressed(image, timing);
+			return;
+		}
+		// the TextureCache only picks a .ktx when it can be uploaded, this one was loaded by name
+		std::cout << "Texture failed to load at path: " << timing.path << " (no S3TC support)" << std::endl;
+		timing.failed = true;
+		return;
+	}
+
+	if (!image.pixels)
+	{
+		std::cout << "Texture failed to load at path: " << timing.path << std::endl;
+		timing.failed = true;
+		return;
+	}
+
+	Timer timer;
+	GLenum format = GL_RGB;
+	if (image.components == 1)
+		format = GL_RED;
+	else if (image.components == 3)
+		format = GL_RGB;
+	else if (image.components == 4)
+		format = GL_RGBA;
+
+	const GLsizeiptr size = GLsizeiptr(image.width) * image.height * image.components;
+	const void* pixels = stage(image.pixels, size);
+
+	// stb_image rows are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLState::instance().bindTexture(GL_TEXTURE_2D, image.textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	stbi_image_free(image.pixels);
+
+	timing.width = image.width;
+	timing.height = image.height;
+	timing.gpuBytes = size_t(size) * 4 / 3;
+	timing.uploadMs = timer.elapsedMs();
+	timing.readyMs = Timer::between(image.requested, Timer::Clock::now());
+	timing.ready = true;
+}
+
+void TextureLoader::uploadCompressed(DecodedImage& image, TextureTiming& timing)
+{
+	Timer timer;
+	const KtxTexture& ktx = *image.compressed;
+	const GLsizei levels = static_cast<GLsizei>(ktx.levels.size());
+	const unsigned char* data = static_cast<const unsigned char*>(stage(ktx.data.data(), static_cast<GLsizeiptr>(ktx.data.size())));
+
+	GLState::instance().bindTexture(GL_TEXTURE_2D, image.textureID);
+	bool immutable = false;
+#ifdef GL_VERSION_4_2
+	if (GLAD_GL_VERSION_4_2)
+	{
+		// the whole chain is allocated once, the driver never has to check it for completeness
+		glTexStorage2D(GL_TEXTURE_2D, levels, ktx.internalFormat, ktx.width, ktx.height);
+		for (GLsizei i = 0; i < levels; i++)
+		{
+			const KtxLevel& level = ktx.levels[i];
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, ktx.internalFormat, static_cast<GLsizei>(level.size), data + level.offset);
+		}
+		immutable = true;
+	}
+#endif
+	if (!immutable)
+	{
+		for (GLsizei i = 0; i < levels; i++)
+		{
+			const KtxLevel& level = ktx.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, ktx.internalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.size), data + level.offset);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+	GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// the mip chain came precomputed, no glGenerateMipmap
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	timing.width = ktx.width;
+	timing.height = ktx.height;
+	timing.gpuBytes = ktx.byteSize();
+	timing.compressed = true;
+	timing.uploadMs = timer.elapsedMs();
+	timing.readyMs = Timer::between(image.requested, Timer::Clock::now());
+	timing.ready = true;
+}
+
+const void* TextureLoader::stage(const void* data, GLsizeiptr size)
+{
+	if (m_UploadBuffers[0] == 0)
+		glGenBuffers(2, m_UploadBuffers);
+	GLuint buffer = m_UploadBuffers[m_NextUploadBuffer];
+	m_NextUploadBuffer = (m_NextUploadBuffer + 1) % 2;
+
+	// orphan the buffer and copy the data in, the driver moves it to the texture asynchronously
+	GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped)
+	{
+		std::memcpy(mapped, data, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		// texture calls now read from the bound buffer, the pointer is an offset into it
+		return nullptr;
+	}
+
+	// could not map, fall back to a plain client memory upload
+	GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return data;
+}
+
+void TextureLoader::setPlaceholder(unsigned int textureID)
+{
+	// 2x2 grey checker shown until the real image arrives
+	static const unsigned char checker[] = {
+		96, 96, 96,    160, 160, 160,
+		160, 160, 160, 96, 96, 96,
+	};
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, checker);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// no mip chain yet, a mipmapped min filter would leave the texture incomplete
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+const TextureTiming* TextureLoader::timing(unsigned int textureID) const
+{
+	// names are reused after glDeleteTextures, the newest entry is the current texture
+	for (auto it = m_Timings.rbegin(); it != m_Timings.rend(); ++it)
+	{
+		if (it->textureID == textureID)
+			return &*it;
+	}
+	return nullptr;
+}
+
+void TextureLoader::printTimings() const
+{
+	std::printf("%-32s %11s %4s %10s %10s %10s %10s\n", "texture", "size", "fmt", "GPU KB", "decode ms", "upload ms", "ready ms");
+	for (const TextureTiming& timing : m_Timings)
+	{
+		if (timing.failed)
+			std::printf("%-32s %11s\n", timing.path.c_str(), "failed");
+		else if (!timing.ready)
+			std::printf("%-32s %11s\n", timing.path.c_str(), "pending");
+		else
+			std::printf("%-32s %5dx%-5d %4s %10.1f %10.2f %10.2f %10.2f\n", timing.path.c_str(), timing.width, timing.height,
+				timing.compressed ? "KTX" : "raw", timing.gpuBytes / 1024.0, timing.decodeMs, timing.uploadMs, timing.readyMs);
+	}
+}
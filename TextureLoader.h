@@ -0,0 +1,106 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include "KtxTexture.h"
+#include "Timer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// decode and upload timings of one texture
+struct TextureTiming
+{
+	std::string path;
+	unsigned int textureID = 0;
+	int width = 0;
+	int height = 0;
+	double decodeMs = 0.0;   // stbi_load or KTX parse on a worker thread
+	double uploadMs = 0.0;   // PBO fill + glTexImage2D + mipmaps on the GL thread
+	double readyMs = 0.0;    // from the request until the real image replaced the placeholder
+	size_t gpuBytes = 0;     // texel storage including the mip chain
+	bool compressed = false; // uploaded from a cooked KTX
+	bool ready = false;
+	bool failed = false;
+};
+
+// Asynchronous texture loading. load() hands out a texture name immediately which shows a
+// placeholder image; the file is decoded on the thread pool and the pixels are queued back to
+// the GL thread, where processUploads() streams them through a pixel buffer object.
+// Cooked KTX files skip the decode, their block compressed mip chain is uploaded as is.
+// load(), processUploads() and finish() must only be called on the thread owning the GL context.
+class TextureLoader
+{
+public:
+	static TextureLoader& instance();
+
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// encoded may hold the file contents if the caller already read them, otherwise the worker reads the file
+	unsigned int load(const std::string& path, std::vector<unsigned char> encoded = {});
+
+	// drops the pending upload of the texture, for textures deleted before their image arrived.
+	// Does nothing once the image is uploaded, GL may already have given the name to another texture
+	void cancel(unsigned int textureID);
+
+	// whether the driver takes the BC1/BC3 blocks of cooked textures, GL thread only
+	static bool compressedSupported();
+
+	// uploads up to maxUploads decoded images, call once per frame
+	void processUploads(unsigned int maxUploads = 4);
+
+	// blocks until every requested texture has been uploaded
+	void finish();
+
+	bool idle();
+
+	const std::vector<TextureTiming>& timings() const { return m_Timings; }
+	// latest load of a texture name, nullptr if it never went through the loader
+	const TextureTiming* timing(unsigned int textureID) const;
+	void printTimings() const;
+
+private:
+	TextureLoader() = default;
+
+	struct DecodedImage
+	{
+		unsigned int textureID;
+		size_t timingIndex;
+		Timer::Clock::time_point requested;
+		unsigned char* pixels;
+		int width, height, components;
+		std::unique_ptr<KtxTexture> compressed;  // set instead of pixels for KTX files
+		double decodeMs;
+	};
+
+	void decode(unsigned int textureID, size_t timingIndex, const std::string& path, const std::vector<unsigned char>& encoded, Timer::Clock::time_point requested);
+	void upload(DecodedImage& image);
+	void uploadCompressed(DecodedImage& image, TextureTiming& timing);
+	const void* stage(const void* data, GLsizeiptr size);
+	void setPlaceholder(unsigned int textureID);
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Decoded;
+	std::deque<DecodedImage> m_Ready;
+	unsigned int m_Decoding = 0;
+
+	// two pixel unpack buffers used in turn so filling one never waits on the other's transfer
+	GLuint m_UploadBuffers[2] = { 0, 0 };
+	unsigned int m_NextUploadBuffer = 0;
+
+	std::vector<TextureTiming> m_Timings;
+	std::unordered_map<unsigned int, size_t> m_Pending;  // texture name to the timing of its upload in flight
+	std::unordered_set<size_t> m_Cancelled;              // timings of the loads whose image is dropped
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads for CPU side loading work (mesh conversion, decoding).
+// Nothing submitted here may touch OpenGL, the context only lives on the main thread.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()))
+	{
+		for (unsigned int i = 0; i < threadCount; i++)
+			m_Workers.emplace_back([this] { workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Condition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// process wide pool shared by all loaders
+	static ThreadPool& shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	unsigned int size() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+	// queues a task, the returned future holds its result
+	template<typename F>
+	auto submit(F&& task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Tasks.emplace([packaged] { (*packaged)(); });
+		}
+		m_Condition.notify_one();
+		return result;
+	}
+
+	// runs body(i) for every i in [0, count) on the pool and the calling thread, returns once all are done.
+	// the caller works through the items too, so this is safe to call from inside a pool task.
+	// if a body throws, the items not started yet are skipped and the first exception is rethrown here.
+	void parallelFor(size_t count, const std::function<void(size_t)>& body)
+	{
+		if (count == 0)
+			return;
+
+		struct Batch
+		{
+			std::function<void(size_t)> body;
+			size_t count;
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> remaining;
+			std::mutex mutex;
+			std::condition_variable done;
+			std::exception_ptr error;  // the first exception, guarded by mutex
+			std::atomic<bool> failed{ false };
+
+			Batch(const std::function<void(size_t)>& b, size_t n) : body(b), count(n), remaining(n) {}
+
+			void work()
+			{
+				for (size_t i = next++; i < count; i = next++)
+				{
+					// every item still counts down, the caller waits for all of them
+					if (!failed)
+					{
+						try
+						{
+							body(i);
+						}
+						catch (...)
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							if (!error)
+								error = std::current_exception();
+							failed = true;
+						}
+					}
+					if (--remaining == 0)
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						done.notify_all();
+					}
+				}
+			}
+		};
+
+		// helpers may start after the batch is finished, so they share ownership of it
+		auto batch = std::make_shared<Batch>(body, count);
+		size_t helpers = std::min<size_t>(count - 1, m_Workers.size());
+		for (size_t i = 0; i < helpers; i++)
+			submit([batch] { batch->work(); });
+
+		batch->work();
+
+		std::unique_lock<std::mutex> lock(batch->mutex);
+		batch->done.wait(lock, [&] { return batch->remaining == 0; });
+		if (batch->error)
+			std::rethrow_exception(batch->error);
+	}
+
+private:
+	void workerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+				if (m_Stopping && m_Tasks.empty())
+					return;
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stopping = false;
+};
+
+#endif
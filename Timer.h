@@ -0,0 +1,33 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <chrono>
+
+// wall clock stopwatch for load timings and benchmarks
+class Timer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	Timer() : m_Start(Clock::now()) {}
+
+	void reset() { m_Start = Clock::now(); }
+
+	Clock::time_point start() const { return m_Start; }
+
+	double elapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - m_Start).count();
+	}
+
+	// milliseconds between two points on the clock
+	static double between(Clock::time_point from, Clock::time_point to)
+	{
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+
+private:
+	Clock::time_point m_Start;
+};
+
+#endif
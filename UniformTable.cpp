@@ -0,0 +1,92 @@
+#include "UniformTable.h"
+
+#include <algorithm>
+#include <iostream>
+
+void UniformTable::reflect(GLuint program)
+{
+	m_Reflected = true;
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+		return;
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	// every active uniform, plus every element of the arrays
+	struct Active
+	{
+		std::string name;
+		GLint size;
+	};
+	std::vector<Active> uniforms;
+	size_t entries = 0;
+	std::vector<char> buffer(std::max(maxLength, 1));
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+		std::string name(buffer.data(), length);
+		// uniforms in blocks have no location, they are set through their buffer
+		if (glGetUniformLocation(program, name.c_str()) < 0)
+			continue;
+		entries += size > 1 ? size + 1 : 1;
+		uniforms.push_back({ std::move(name), size });
+	}
+
+	uint32_t capacity = 16;
+	while (capacity < entries * 2)
+		capacity *= 2;
+	m_Slots.assign(capacity, Slot());
+	m_Mask = capacity - 1;
+	m_Count = 0;
+
+	std::vector<std::string> names(capacity);
+	for (const Active& uniform : uniforms)
+	{
+		const size_t bracket = uniform.name.find('[');
+		if (bracket == std::string::npos || uniform.name.compare(bracket, std::string::npos, "[0]") != 0)
+		{
+			insert(uniform.name, glGetUniformLocation(program, uniform.name.c_str()), names);
+			continue;
+		}
+
+		// "bones[0]" for an array; array elements need not have consecutive locations
+		const std::string base = uniform.name.substr(0, bracket);
+		insert(base, glGetUniformLocation(program, uniform.name.c_str()), names);
+		for (GLint element = 0; element < uniform.size; element++)
+		{
+			const std::string name = base + "[" + std::to_string(element) + "]";
+			insert(name, glGetUniformLocation(program, name.c_str()), names);
+		}
+	}
+}
+
+void UniformTable::insert(const std::string& name, GLint location, std::vector<std::string>& names)
+{
+	if (location < 0)
+		return;
+	const UniformName key(name);
+	for (uint32_t i = key.hash & m_Mask;; i = (i + 1) & m_Mask)
+	{
+		Slot& slot = m_Slots[i];
+		if (slot.location < 0)
+		{
+			slot.hash = key.hash;
+			slot.location = location;
+			names[i] = name;
+			m_Count++;
+			return;
+		}
+		if (slot.hash == key.hash)
+		{
+			if (names[i] != name)
+				std::cout << "ERROR::SHADER:: uniforms " << names[i] << " and " << name << " have the same hash, rename one" << std::endl;
+			return;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A uniform's name as a 32 bit FNV-1a hash. String literals hash in a constexpr constructor, so
+// "projection" costs nothing at run time once the compiler folds it, and a constexpr UniformName
+// is guaranteed to; names built at run time should be hashed once and kept.
+struct UniformName
+{
+	uint32_t hash;
+
+	template<size_t N>
+	constexpr UniformName(const char (&name)[N]) : hash(fnv1a(name, N - 1)) {}
+	UniformName(const std::string& name) : hash(fnv1a(name.data(), name.size())) {}
+
+	static constexpr uint32_t fnv1a(const char* text, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(text[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+};
+
+// The active uniforms of a linked program, enumerated once and found by hash. Arrays are in the
+// table under their plain name and as "name[i]" for every element, the plain name is element 0.
+class UniformTable
+{
+public:
+	void reflect(GLuint program);
+	bool reflected() const { return m_Reflected; }
+
+	// -1 for names the program doesn't use, like glGetUniformLocation
+	GLint location(UniformName name) const
+	{
+		if (m_Slots.empty())
+			return -1;
+		for (uint32_t i = name.hash & m_Mask;; i = (i + 1) & m_Mask)
+		{
+			const Slot& slot = m_Slots[i];
+			if (slot.location < 0 || slot.hash == name.hash)
+				return slot.location;
+		}
+	}
+
+	size_t size() const { return m_Count; }
+
+private:
+	struct Slot
+	{
+		uint32_t hash = 0;
+		GLint location = -1;  // -1 marks an empty slot
+	};
+
+	void insert(const std::string& name, GLint location, std::vector<std::string>& names);
+
+	// open addressing with linear probing, at most half full
+	std::vector<Slot> m_Slots;
+	uint32_t m_Mask = 0;
+	size_t m_Count = 0;
+	bool m_Reflected = false;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include"VAO.h"
+#include"GLState.h"
 
 // Constructor that generates a VAO ID
 VAO::VAO()
@@ -18,17 +19,17 @@ void VAO::LinkVBO(VBO& VBO, GLuint layout)
 // Binds the VAO
 void VAO::Bind()
 {
-	glBindVertexArray(ID);
+	GLState::instance().bindVertexArray(ID);
 }
 
 // Unbinds the VAO
 void VAO::Unbind()
 {
-	glBindVertexArray(0);
+	GLState::instance().bindVertexArray(0);
 }
 
 // Deletes the VAO
 void VAO::Delete()
 {
-	glDeleteVertexArrays(1, &ID);
+	GLState::instance().deleteVertexArray(ID);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include"VBO.h"
+#include"GLState.h"
 
 // Constructor that generates a Vertex Buffer Object and links it to vertices
 VBO::VBO()
@@ -9,26 +10,26 @@ VBO::VBO()
 
 void VBO::setup(GLfloat* vertices, GLsizeiptr size) {
 	glGenBuffers(1, &ID);
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	GLState::instance().bindBuffer(GL_ARRAY_BUFFER, ID);
 	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
 // Binds the VBO
 void VBO::Bind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	GLState::instance().bindBuffer(GL_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the VBO
 void VBO::Unbind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::instance().bindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 // Deletes the VBO
 void VBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	GLState::instance().deleteBuffer(ID);
 }
 
 //EBO
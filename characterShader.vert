@@ -4,12 +4,22 @@ layout (location = 1) in vec3 aColor;
 
 out vec3 ourColor;
 uniform mat4 char_model;
-uniform mat4 view;
-uniform mat4 char_projection;
+
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
 
 
 void main()
 {
-    gl_Position = char_projection * view * char_model * vec4(aPos, 1.2f);
+    gl_Position = projection * view * char_model * vec4(aPos, 1.2f);
     ourColor = aColor;
 }
\ No newline at end of file
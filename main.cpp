@@ -1,11 +1,20 @@
 
 #include "Game.h"
+#include "Benchmark.h"
+#include "TextureCooker.h"
 
 
 
 
-int main(void)
+int main(int argc, char** argv)
 {
+	// "--bench <name>" runs one of the offline benchmarks instead of the game
+	if (argc > 2 && std::string(argv[1]) == "--bench")
+		return Benchmark::run(argv[2]);
+
+	// "--cook [images...]" compresses textures into .ktx files next to them, the game's set by default
+	if (argc > 1 && std::string(argv[1]) == "--cook")
+		return TextureCooker::run(std::vector<std::string>(argv + 2, argv + argc));
 
 	Game::init();
 
@@ -0,0 +1,50 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in ivec4 boneIds;
+layout (location = 6) in vec4 weights;
+
+out vec2 TexCoords;
+
+uniform mat4 model;
+
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+
+// this instance's slot of the BonePalette
+layout (std140) uniform Bones
+{
+    mat4 finalBonesMatrices[MAX_BONES];
+};
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0);
+    float totalWeight = 0.0;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        if (boneIds[i] < 0 || boneIds[i] >= MAX_BONES)
+            continue;
+        totalPosition += finalBonesMatrices[boneIds[i]] * vec4(aPos, 1.0) * weights[i];
+        totalWeight += weights[i];
+    }
+    // vertices no bone moves stay where they are
+    if (totalWeight == 0.0)
+        totalPosition = vec4(aPos, 1.0);
+
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * totalPosition;
+}
\ No newline at end of file